@@ -0,0 +1,8 @@
+// 4-qubit GHZ preparation: regression circuit shared across language entries.
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[4];
+h q[0];
+cx q[0], q[1];
+cx q[0], q[2];
+cx q[0], q[3];
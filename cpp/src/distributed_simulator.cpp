@@ -0,0 +1,281 @@
+#include "distributed_simulator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// MPI counts are int; large shard exchanges go out in slices below 2^31
+// bytes.
+constexpr size_t kMaxMessageBytes = 1ULL << 30;
+
+size_t log2_exact(size_t value) {
+    size_t bits = 0;
+    while ((1ULL << bits) < value) {
+        ++bits;
+    }
+    return bits;
+}
+
+}  // namespace
+
+template <typename Scalar>
+DistributedQuantumStateT<Scalar>::DistributedQuantumStateT(size_t num_qubits, MPI_Comm comm)
+    : local_(1),  // placeholder; re-sized below once the shard width is known
+      comm_(comm),
+      num_qubits_(num_qubits) {
+    MPI_Comm_rank(comm_, &rank_);
+    MPI_Comm_size(comm_, &comm_size_);
+
+    size_t ranks = static_cast<size_t>(comm_size_);
+    if ((ranks & (ranks - 1)) != 0) {
+        throw std::runtime_error("Distributed state requires a power-of-two rank count");
+    }
+    num_sharded_qubits_ = log2_exact(ranks);
+    if (num_qubits_ < num_sharded_qubits_ + kMinLocalQubits) {
+        // Narrower shards can leave swap_down with every local position
+        // pinned by the operation and no legal victim (see kMinLocalQubits).
+        throw std::runtime_error("Distributed state needs at least " +
+                                 std::to_string(kMinLocalQubits) +
+                                 " local qubits per rank");
+    }
+    num_local_qubits_ = num_qubits_ - num_sharded_qubits_;
+
+    local_ = QuantumStateT<Scalar>(num_local_qubits_);
+    if (rank_ != 0) {
+        // Global |0...0> lives on rank 0; every other shard starts empty.
+        local_.data()[0] = Amplitude(0.0, 0.0);
+    }
+
+    qubit_map_.resize(num_qubits_);
+    position_map_.resize(num_qubits_);
+    for (size_t q = 0; q < num_qubits_; ++q) {
+        qubit_map_[q] = q;
+        position_map_[q] = q;
+    }
+}
+
+template <typename Scalar>
+void DistributedQuantumStateT<Scalar>::apply(const std::vector<Operation>& ops) {
+    for (const Operation& op : ops) {
+        apply_operation(op);
+    }
+}
+
+template <typename Scalar>
+void DistributedQuantumStateT<Scalar>::apply_operation(const Operation& op) {
+    switch (op.type) {
+        case Operation::SINGLE_GATE: {
+            size_t p = physical(op.qubit);
+            if (is_local(p)) {
+                local_.apply_single_gate(op.gate, p, op.gate_class);
+                break;
+            }
+            if (op.gate_class == GateClass::DIAGONAL) {
+                // The sharded bit is constant across the shard, so the gate
+                // collapses to one scalar factor - no exchange.
+                scale_shard(Amplitude(shard_bit(p) ? op.gate(1, 1) : op.gate(0, 0)));
+                break;
+            }
+            p = localize(op.qubit, {});
+            local_.apply_single_gate(op.gate, p, op.gate_class);
+            break;
+        }
+
+        case Operation::CONTROLLED_PHASE: {
+            // Fully diagonal: sharded bits are resolved per rank, any
+            // remaining local bits stay a local diagonal update.
+            Amplitude phase(op.gate(1, 1));
+            size_t pc = physical(op.control);
+            size_t pt = physical(op.target);
+            bool satisfied = true;
+            std::vector<size_t> local_bits;
+            for (size_t p : {pc, pt}) {
+                if (is_local(p)) {
+                    local_bits.push_back(p);
+                } else {
+                    satisfied = satisfied && shard_bit(p);
+                }
+            }
+            if (!satisfied) {
+                break;
+            }
+            if (local_bits.size() == 2) {
+                local_.apply_controlled_phase(op.gate(1, 1), local_bits[0], local_bits[1]);
+            } else if (local_bits.size() == 1) {
+                Gate diag;
+                diag << Complex(1, 0), Complex(0, 0), Complex(0, 0), op.gate(1, 1);
+                local_.apply_single_gate(diag, local_bits[0], GateClass::DIAGONAL);
+            } else {
+                scale_shard(phase);
+            }
+            break;
+        }
+
+        case Operation::CONTROLLED_GATE: {
+            size_t pt = physical(op.target);
+            if (!is_local(pt)) {
+                pt = localize(op.target, {physical(op.control)});
+            }
+            size_t pc = physical(op.control);
+            if (is_local(pc)) {
+                local_.apply_controlled_gate(op.gate, pc, pt);
+            } else if (shard_bit(pc)) {
+                // Every amplitude in this shard has the control set: the
+                // gate degenerates to an unconditional local update.
+                local_.apply_single_gate(op.gate, pt);
+            }
+            break;
+        }
+
+        case Operation::MULTI_CONTROLLED_GATE: {
+            std::vector<size_t> control_positions;
+            for (size_t c : op.controls) {
+                control_positions.push_back(physical(c));
+            }
+            size_t pt = physical(op.target);
+            if (!is_local(pt)) {
+                pt = localize(op.target, control_positions);
+            }
+            bool satisfied = true;
+            std::vector<size_t> local_controls;
+            for (size_t c : op.controls) {
+                size_t pc = physical(c);
+                if (is_local(pc)) {
+                    local_controls.push_back(pc);
+                } else {
+                    satisfied = satisfied && shard_bit(pc);
+                }
+            }
+            if (!satisfied) {
+                break;
+            }
+            if (local_controls.empty()) {
+                local_.apply_single_gate(op.gate, pt);
+            } else if (local_controls.size() == 1) {
+                local_.apply_controlled_gate(op.gate, local_controls[0], pt);
+            } else {
+                local_.apply_multi_controlled_gate(op.gate, local_controls, pt);
+            }
+            break;
+        }
+
+        case Operation::TWO_QUBIT_GATE: {
+            size_t p0 = physical(op.control);
+            if (!is_local(p0)) {
+                p0 = localize(op.control, {physical(op.target)});
+            }
+            size_t p1 = physical(op.target);
+            if (!is_local(p1)) {
+                p1 = localize(op.target, {p0});
+            }
+            local_.apply_two_qubit_gate(op.two_qubit_gate, p0, p1);
+            break;
+        }
+    }
+}
+
+template <typename Scalar>
+size_t DistributedQuantumStateT<Scalar>::localize(size_t qubit, const std::vector<size_t>& keep) {
+    size_t p = physical(qubit);
+    if (is_local(p)) {
+        return p;
+    }
+    return swap_down(p, keep);
+}
+
+template <typename Scalar>
+size_t DistributedQuantumStateT<Scalar>::swap_down(size_t position, const std::vector<size_t>& keep) {
+    // Round-robin victim among local positions not pinned by the current
+    // operation, so successive remaps spread over the local range instead
+    // of thrashing one slot.
+    size_t victim;
+    do {
+        victim = next_victim_;
+        next_victim_ = (next_victim_ + 1) % num_local_qubits_;
+    } while (std::find(keep.begin(), keep.end(), victim) != keep.end());
+
+    // Swapping global index bits (victim, position) moves exactly the
+    // amplitudes whose victim bit differs from this rank's shard bit:
+    // both sides pack that half-shard in the same residual-bit order and
+    // exchange it pairwise.
+    bool bit = shard_bit(position);
+    int partner = rank_ ^ (1 << (position - num_local_qubits_));
+    size_t half = local_.size() >> 1;
+    size_t low_mask = (1ULL << victim) - 1;
+    size_t moved = bit ? 0ULL : 1ULL;  // victim-bit value of the moving half
+    Amplitude* data = local_.data();
+
+    std::vector<Amplitude> sendbuf(half);
+    std::vector<Amplitude> recvbuf(half);
+    #pragma omp parallel for
+    for (size_t p = 0; p < half; ++p) {
+        size_t i = ((p >> victim) << (victim + 1)) | (p & low_mask) | (moved << victim);
+        sendbuf[p] = data[i];
+    }
+
+    size_t bytes = half * sizeof(Amplitude);
+    size_t offset = 0;
+    while (offset < bytes) {
+        int chunk = static_cast<int>(std::min(bytes - offset, kMaxMessageBytes));
+        MPI_Sendrecv(reinterpret_cast<char*>(sendbuf.data()) + offset, chunk, MPI_BYTE,
+                     partner, 0,
+                     reinterpret_cast<char*>(recvbuf.data()) + offset, chunk, MPI_BYTE,
+                     partner, 0, comm_, MPI_STATUS_IGNORE);
+        offset += static_cast<size_t>(chunk);
+    }
+
+    #pragma omp parallel for
+    for (size_t p = 0; p < half; ++p) {
+        size_t i = ((p >> victim) << (victim + 1)) | (p & low_mask) | (moved << victim);
+        data[i] = recvbuf[p];
+    }
+    ++num_exchanges_;
+
+    size_t logical_low = position_map_[victim];
+    size_t logical_high = position_map_[position];
+    std::swap(position_map_[victim], position_map_[position]);
+    qubit_map_[logical_low] = position;
+    qubit_map_[logical_high] = victim;
+    return victim;
+}
+
+template <typename Scalar>
+void DistributedQuantumStateT<Scalar>::scale_shard(const Amplitude& factor) {
+    Eigen::Map<StateVectorT<Scalar>>(local_.data(), local_.size()) *= factor;
+}
+
+template <typename Scalar>
+double DistributedQuantumStateT<Scalar>::get_probability(size_t state) const {
+    size_t phys = 0;
+    for (size_t q = 0; q < num_qubits_; ++q) {
+        if ((state >> q) & 1) {
+            phys |= 1ULL << qubit_map_[q];
+        }
+    }
+    int owner = static_cast<int>(phys >> num_local_qubits_);
+    double prob = 0.0;
+    if (rank_ == owner) {
+        prob = local_.get_probability(phys & (local_.size() - 1));
+    }
+    MPI_Bcast(&prob, 1, MPI_DOUBLE, owner, comm_);
+    return prob;
+}
+
+template <typename Scalar>
+double DistributedQuantumStateT<Scalar>::total_norm() const {
+    const Amplitude* data = local_.data();
+    size_t size = local_.size();
+    double local_sum = 0.0;
+    #pragma omp parallel for reduction(+:local_sum)
+    for (size_t i = 0; i < size; ++i) {
+        local_sum += static_cast<double>(std::norm(data[i]));
+    }
+    double total = 0.0;
+    MPI_Allreduce(&local_sum, &total, 1, MPI_DOUBLE, MPI_SUM, comm_);
+    return total;
+}
+
+template class DistributedQuantumStateT<double>;
+template class DistributedQuantumStateT<float>;
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "quantum_simulator.hpp"
+
+#include <mpi.h>
+
+// Distributed state vector: the amplitude array is sharded across MPI
+// ranks by its high-order index bits, so rank r owns the global indices
+// (r << local_qubits) .. ((r + 1) << local_qubits) - 1 and each shard is
+// itself a valid local state vector running the existing QuantumStateT
+// kernels unchanged.
+//
+// Gates on local (low) qubits touch no network. Gates on sharded qubits
+// avoid communication wherever the structure allows it: a control bit on
+// a sharded qubit is resolved per rank (the whole shard either satisfies
+// it or is untouched), and diagonal factors become a shard-wide scale.
+// Only a non-diagonal update of a sharded qubit moves data, and instead
+// of exchanging amplitudes per gate the qubit is swapped down into the
+// local range once (one pairwise half-shard exchange) and stays there -
+// the logical-to-physical map makes every later gate on it rank-local.
+template <typename Scalar>
+class DistributedQuantumStateT {
+public:
+    using Amplitude = std::complex<Scalar>;
+
+    // Collective. The communicator size must be a power of two and leave
+    // at least kMinLocalQubits local qubits per rank; throws
+    // std::runtime_error otherwise.
+    DistributedQuantumStateT(size_t num_qubits, MPI_Comm comm);
+
+    // Narrowest shard a rank may hold. A swap-down needs a local victim
+    // position the current operation does not pin, and the widest pin set
+    // in the gate set is ccx with both controls local (two positions), so
+    // two local qubits or fewer could leave no victim at all.
+    static constexpr size_t kMinLocalQubits = 3;
+
+    // Applies a fused operation stream, e.g. circuit.fused_operations().
+    // Collective: every rank walks the same stream.
+    void apply(const std::vector<Operation>& ops);
+
+    void apply_operation(const Operation& op);
+
+    // Collective probability of one global basis state; every rank
+    // returns the same value.
+    double get_probability(size_t state) const;
+
+    // Collective sum of |amplitude|^2 across all shards (1 up to
+    // rounding); the cheapest cross-rank sanity check.
+    double total_norm() const;
+
+    size_t num_qubits() const { return num_qubits_; }
+    size_t num_local_qubits() const { return num_local_qubits_; }
+    size_t num_sharded_qubits() const { return num_sharded_qubits_; }
+    int rank() const { return rank_; }
+
+    // Pairwise half-shard exchanges performed so far; the number the
+    // remapping policy exists to minimize.
+    size_t num_exchanges() const { return num_exchanges_; }
+
+private:
+    // Physical bit position of a logical qubit under the current remap.
+    size_t physical(size_t qubit) const { return qubit_map_[qubit]; }
+    bool is_local(size_t position) const { return position < num_local_qubits_; }
+    bool shard_bit(size_t position) const {
+        return (static_cast<size_t>(rank_) >> (position - num_local_qubits_)) & 1;
+    }
+
+    // Swaps a sharded physical position down into the local range via one
+    // pairwise half-shard exchange, updating the logical map. Positions
+    // listed in keep stay where they are when picking the victim.
+    size_t swap_down(size_t position, const std::vector<size_t>& keep);
+
+    // Ensures the logical qubit is on a local physical position, remapping
+    // if needed, and returns that position.
+    size_t localize(size_t qubit, const std::vector<size_t>& keep);
+
+    void scale_shard(const Amplitude& factor);
+
+    QuantumStateT<Scalar> local_;
+    MPI_Comm comm_;
+    int rank_;
+    int comm_size_;
+    size_t num_qubits_;
+    size_t num_local_qubits_;
+    size_t num_sharded_qubits_;
+    std::vector<size_t> qubit_map_;      // logical -> physical position
+    std::vector<size_t> position_map_;   // physical position -> logical
+    size_t next_victim_ = 0;             // round-robin swap-down victim
+    size_t num_exchanges_ = 0;
+};
+
+using DistributedQuantumState = DistributedQuantumStateT<double>;
@@ -1,65 +1,314 @@
 #include "quantum_simulator.hpp"
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <chrono>
 #include <iomanip>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Serializes one result. With a non-empty indent the object is pretty
+// printed for the suite array; with an empty indent it collapses to a
+// single line for the streamed partial output.
+std::string result_to_json(const BenchmarkResult& result, const std::string& indent) {
+    std::string pad = indent.empty() ? "" : indent + "  ";
+    std::string nl = indent.empty() ? "" : "\n";
+    std::string sep = indent.empty() ? " " : "";
+
+    std::ostringstream oss;
+    oss << indent << "{" << nl;
+    oss << pad << "\"name\": \"" << result.name << "\"," << sep << nl;
+    oss << pad << "\"num_qubits\": " << result.num_qubits << "," << sep << nl;
+    oss << pad << "\"num_gates\": " << result.num_gates << "," << sep << nl;
+    oss << pad << "\"execution_time_ms\": " << std::fixed << std::setprecision(6) << result.execution_time_ms << "," << sep << nl;
+    oss << pad << "\"memory_usage_mb\": " << std::fixed << std::setprecision(2) << result.memory_usage_mb << "," << sep << nl;
+    oss << pad << "\"peak_rss_mb\": " << std::fixed << std::setprecision(2) << result.memory.peak_rss_mb << "," << sep << nl;
+    oss << pad << "\"peak_heap_mb\": " << std::fixed << std::setprecision(2) << result.memory.peak_heap_mb << "," << sep << nl;
+    oss << pad << "\"allocated_mb\": " << std::fixed << std::setprecision(2) << result.memory.allocated_mb << "," << sep << nl;
+    oss << pad << "\"circuit_depth\": " << result.circuit_depth << "," << sep << nl;
+    oss << pad << "\"num_threads\": " << result.num_threads << "," << sep << nl;
+    oss << pad << "\"num_fused_gates\": " << result.num_fused_gates << "," << sep << nl;
+    oss << pad << "\"construction_time_ms\": " << std::fixed << std::setprecision(6) << result.construction_time_ms << "," << sep << nl;
+    oss << pad << "\"repetitions\": " << result.repetitions << "," << sep << nl;
+    oss << pad << "\"time_min_ms\": " << std::fixed << std::setprecision(6) << result.timing.min_ms << "," << sep << nl;
+    oss << pad << "\"time_median_ms\": " << std::fixed << std::setprecision(6) << result.timing.median_ms << "," << sep << nl;
+    oss << pad << "\"time_p95_ms\": " << std::fixed << std::setprecision(6) << result.timing.p95_ms << "," << sep << nl;
+    oss << pad << "\"time_stddev_ms\": " << std::fixed << std::setprecision(6) << result.timing.stddev_ms << "," << sep << nl;
+    oss << pad << "\"precision\": \"" << result.precision << "\"," << sep << nl;
+    oss << pad << "\"seed\": " << result.seed << nl;
+    oss << indent << "}";
+    return oss.str();
+}
+
 std::string to_json(const BenchmarkSuite& suite) {
     std::ostringstream oss;
     oss << "{\n";
     oss << "  \"library\": \"" << suite.library << "\",\n";
     oss << "  \"version\": \"" << suite.version << "\",\n";
     oss << "  \"results\": [\n";
-    
+
     for (size_t i = 0; i < suite.results.size(); ++i) {
-        const auto& result = suite.results[i];
-        oss << "    {\n";
-        oss << "      \"name\": \"" << result.name << "\",\n";
-        oss << "      \"num_qubits\": " << result.num_qubits << ",\n";
-        oss << "      \"num_gates\": " << result.num_gates << ",\n";
-        oss << "      \"execution_time_ms\": " << std::fixed << std::setprecision(6) << result.execution_time_ms << ",\n";
-        oss << "      \"memory_usage_mb\": " << std::fixed << std::setprecision(2) << result.memory_usage_mb << ",\n";
-        oss << "      \"circuit_depth\": " << result.circuit_depth << "\n";
-        oss << "    }";
+        oss << result_to_json(suite.results[i], "    ");
         if (i < suite.results.size() - 1) {
             oss << ",";
         }
         oss << "\n";
     }
-    
+
     oss << "  ],\n";
+
+    if (Profiler::enabled()) {
+        auto profile = Profiler::report();
+        oss << "  \"profile\": [\n";
+        for (size_t i = 0; i < profile.size(); ++i) {
+            const auto& entry = profile[i];
+            oss << "    {\n";
+            oss << "      \"kind\": \"" << entry.kind << "\",\n";
+            oss << "      \"calls\": " << entry.calls << ",\n";
+            oss << "      \"cycles\": " << entry.cycles << ",\n";
+            oss << "      \"time_ms\": " << std::fixed << std::setprecision(6) << entry.time_ms << ",\n";
+            oss << "      \"amplitudes_swept\": " << entry.amplitudes_swept << ",\n";
+            oss << "      \"bandwidth_gbps\": " << std::fixed << std::setprecision(3) << entry.bandwidth_gbps << "\n";
+            oss << "    }";
+            if (i < profile.size() - 1) {
+                oss << ",";
+            }
+            oss << "\n";
+        }
+        oss << "  ],\n";
+    }
+
     oss << "  \"total_time_ms\": " << std::fixed << std::setprecision(2) << suite.total_time_ms << "\n";
     oss << "}";
     
     return oss.str();
 }
 
-int main() {
+// Streams each completed case to <path>.partial as one JSON line (flushed
+// immediately, so a killed run keeps everything finished so far and the
+// file can be tailed live), then finalize() writes the full suite to a
+// temp file and renames it over <path> - an atomic publish - and drops
+// the partial.
+class StreamingResultWriter {
+public:
+    explicit StreamingResultWriter(std::string path) : path_(std::move(path)) {
+        if (!path_.empty()) {
+            partial_.open(path_ + ".partial");
+        }
+    }
+
+    void append(const BenchmarkResult& result) {
+        if (!partial_.is_open()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        partial_ << result_to_json(result, "") << "\n";
+        partial_.flush();
+    }
+
+    void finalize(const BenchmarkSuite& suite) {
+        if (path_.empty()) {
+            return;
+        }
+        std::string tmp = path_ + ".tmp";
+        {
+            std::ofstream out(tmp);
+            out << to_json(suite) << "\n";
+        }
+        std::rename(tmp.c_str(), path_.c_str());
+        partial_.close();
+        std::remove((path_ + ".partial").c_str());
+    }
+
+private:
+    std::string path_;
+    std::ofstream partial_;
+    std::mutex mutex_;
+};
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> circuit_files;
+    std::string output_path;
+    uint64_t seed = 12345;  // fixed default keeps runs comparable
+    std::vector<size_t> pinned_qubits;
+    BenchmarkPlanner::Budget budget;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--circuit" && i + 1 < argc) {
+            circuit_files.push_back(argv[++i]);
+        } else if (arg == "--output" && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (arg == "--qubits" && i + 1 < argc) {
+            pinned_qubits.push_back(std::stoul(argv[++i]));
+        } else if (arg == "--time-budget" && i + 1 < argc) {
+            budget.time_ms = std::stod(argv[++i]);
+        } else if (arg == "--memory-budget" && i + 1 < argc) {
+            budget.memory_mb = std::stod(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        } else if (arg == "--reps" && i + 1 < argc) {
+            BenchmarkRunner::set_repetitions(std::stoul(argv[++i]));
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            BenchmarkRunner::set_warmup(std::stoul(argv[++i]));
+        } else if (arg == "--precision" && i + 1 < argc) {
+            std::string precision = argv[++i];
+            BenchmarkRunner::set_precision(precision == "single"
+                                               ? BenchmarkRunner::Precision::SINGLE
+                                               : BenchmarkRunner::Precision::DOUBLE);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            int threads = std::stoi(argv[++i]);
+#ifdef _OPENMP
+            omp_set_num_threads(threads);
+#else
+            std::cerr << "Warning: built without OpenMP, --threads " << threads
+                      << " ignored" << std::endl;
+#endif
+        }
+    }
+
     auto suite_start = std::chrono::high_resolution_clock::now();
-    std::vector<BenchmarkResult> results;
-    
+
     std::cerr << "Starting C++ quantum benchmarks..." << std::endl;
-    
-    std::vector<size_t> qubit_sizes = {4, 6, 8, 10, 12};
-    
-    for (size_t num_qubits : qubit_sizes) {
-        if (num_qubits <= 14) {
-            std::cerr << "Benchmarking " << num_qubits << " qubits..." << std::endl;
-            
-            // GHZ state benchmark
-            results.push_back(BenchmarkRunner::benchmark_ghz_state(num_qubits));
-            
-            // Random circuit benchmark
-            size_t gate_count = num_qubits * 10;
-            results.push_back(BenchmarkRunner::benchmark_random_circuit(num_qubits, gate_count));
-            
-            // QFT benchmark (only for smaller systems)
-            if (num_qubits <= 10) {
-                results.push_back(BenchmarkRunner::benchmark_qft_circuit(num_qubits));
+
+    // The sweep adapts to the machine: the planner calibrates sweep cost
+    // and memory, then each family grows to its own frontier within the
+    // time/memory budget (--time-budget ms, --memory-budget MB). Repeated
+    // --qubits pins an explicit grid for every family instead, for runs
+    // that must match another machine point-for-point. Gate-count models
+    // are per family; trajectory and batch cases scale theirs by the
+    // replication factor and hold more live states.
+    BenchmarkPlanner planner(budget);
+    auto plan = [&](std::function<size_t(size_t)> gates_for,
+                    size_t live_states) -> std::vector<size_t> {
+        if (!pinned_qubits.empty()) {
+            return pinned_qubits;
+        }
+        return planner.plan(gates_for, live_states);
+    };
+    // GHZ's cnot chain targets the high qubits, and those strided
+    // half-sweeps run at about half the calibrated unit-stride rate, so
+    // the family charges two sweeps per gate.
+    std::vector<size_t> ghz_sizes = plan([](size_t n) { return 2 * n; }, 2);
+    std::vector<size_t> random_sizes =
+        plan([](size_t n) { return n * 10 + n * 10 / 4; }, 2);
+    std::vector<size_t> noisy_sizes =
+        plan([](size_t n) { return 32 * 5 * (n * 10 + n * 10 / 4); }, 2);
+    std::vector<size_t> qft_sizes =
+        plan([](size_t n) { return n + n * (n - 1) / 2; }, 2);
+    std::vector<size_t> vqe_sizes = plan([](size_t n) { return 14 * n; }, 2);
+    std::vector<size_t> vqe_batch_sizes =
+        plan([](size_t n) { return 32 * 12 * n; }, 34);
+    if (pinned_qubits.empty()) {
+        std::cerr << "Planned frontiers (" << std::fixed << std::setprecision(0)
+                  << planner.available_memory_mb() << " MB available, "
+                  << std::setprecision(3) << planner.sweep_ns_per_amplitude()
+                  << " ns/amplitude): GHZ<=" << ghz_sizes.back()
+                  << " Random<=" << random_sizes.back()
+                  << " NoisyRandom<=" << noisy_sizes.back()
+                  << " QFT<=" << qft_sizes.back()
+                  << " VQE<=" << vqe_sizes.back()
+                  << " VQEBatch<=" << vqe_batch_sizes.back() << std::endl;
+    }
+
+    // Each case is self-contained, so the scheduler runs small ones
+    // concurrently and reserves the machine for cases wide enough to use
+    // the parallel kernels.
+    BenchmarkScheduler scheduler;
+    StreamingResultWriter writer(output_path);
+    scheduler.set_result_callback([&writer](const BenchmarkResult& result) {
+        writer.append(result);
+    });
+
+    // File-driven mode: benchmark the checked-in circuits instead of the
+    // generated suite, parsing entirely off the timed path.
+    if (!circuit_files.empty()) {
+        for (const std::string& path : circuit_files) {
+            try {
+                QuantumCircuit circuit = QasmLoader::load_file(path);
+                std::string name = path.substr(path.find_last_of('/') + 1);
+                scheduler.add(circuit.num_qubits(), [circuit, name]() {
+                    return BenchmarkRunner::benchmark_circuit(circuit, name);
+                });
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
             }
         }
+        std::vector<BenchmarkResult> results = scheduler.run();
+
+        auto circuits_end = std::chrono::high_resolution_clock::now();
+        auto circuits_duration =
+            std::chrono::duration_cast<std::chrono::milliseconds>(circuits_end - suite_start);
+        BenchmarkSuite circuit_suite = {
+            "C++",
+            "1.0.0",
+            results,
+            static_cast<double>(circuits_duration.count())
+        };
+        writer.finalize(circuit_suite);
+        std::cout << to_json(circuit_suite) << std::endl;
+        std::cerr << "C++ circuit benchmarks completed in " << circuits_duration.count()
+                  << "ms" << std::endl;
+        return 0;
     }
-    
+
+    // GHZ state benchmark, plus the same circuit on the sparse backend:
+    // the pair charts the sparse-vs-dense crossover
+    for (size_t num_qubits : ghz_sizes) {
+        scheduler.add(num_qubits, [num_qubits]() {
+            return BenchmarkRunner::benchmark_ghz_state(num_qubits);
+        });
+        scheduler.add(num_qubits, [num_qubits]() {
+            return BenchmarkRunner::benchmark_sparse_ghz(num_qubits);
+        });
+    }
+
+    // Random circuit benchmark
+    for (size_t num_qubits : random_sizes) {
+        size_t gate_count = num_qubits * 10;
+        scheduler.add(num_qubits, [num_qubits, gate_count, seed]() {
+            return BenchmarkRunner::benchmark_random_circuit(num_qubits, gate_count, seed);
+        });
+    }
+
+    // The same random circuit with per-gate noise, run as Monte Carlo
+    // trajectories; against the noiseless case it prices the channels.
+    // Exclusive at every width: the trajectory team must get the whole
+    // machine, not a pool worker's single pinned core.
+    for (size_t num_qubits : noisy_sizes) {
+        size_t gate_count = num_qubits * 10;
+        scheduler.add(num_qubits, [num_qubits, gate_count, seed]() {
+            return BenchmarkRunner::benchmark_noisy_random(num_qubits, gate_count, 32, seed);
+        }, true);
+    }
+
+    // QFT benchmark
+    for (size_t num_qubits : qft_sizes) {
+        scheduler.add(num_qubits, [num_qubits]() {
+            return BenchmarkRunner::benchmark_qft_circuit(num_qubits);
+        });
+    }
+
+    // VQE ansatz benchmark
+    for (size_t num_qubits : vqe_sizes) {
+        scheduler.add(num_qubits, [num_qubits]() {
+            return BenchmarkRunner::benchmark_vqe_ansatz(num_qubits, 4);
+        });
+    }
+
+    // Same ansatz swept over a parameter batch in one interleaved pass
+    for (size_t num_qubits : vqe_batch_sizes) {
+        scheduler.add(num_qubits, [num_qubits]() {
+            return BenchmarkRunner::benchmark_vqe_batch(num_qubits, 4, 32);
+        });
+    }
+    std::vector<BenchmarkResult> results = scheduler.run();
+
     auto suite_end = std::chrono::high_resolution_clock::now();
     auto total_duration = std::chrono::duration_cast<std::chrono::milliseconds>(suite_end - suite_start);
     
@@ -70,6 +319,7 @@ int main() {
         static_cast<double>(total_duration.count())
     };
     
+    writer.finalize(benchmark_suite);
     std::cout << to_json(benchmark_suite) << std::endl;
     std::cerr << "C++ benchmarks completed in " << total_duration.count() << "ms" << std::endl;
     
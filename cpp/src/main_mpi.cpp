@@ -0,0 +1,166 @@
+#include "distributed_simulator.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Distributed benchmark driver: every rank builds the same circuit,
+// executes it against the sharded state, and rank 0 reports one JSON
+// line per case. Run as e.g.
+//     mpirun -np 8 ./cpp_benchmark_mpi --qubits 32 --qubits 34
+
+namespace {
+
+QuantumCircuit make_ghz(size_t num_qubits) {
+    QuantumCircuit circuit(num_qubits);
+    circuit.h(0);
+    for (size_t i = 1; i < num_qubits; ++i) {
+        circuit.cnot(0, i);
+    }
+    return circuit;
+}
+
+QuantumCircuit make_qft(size_t num_qubits) {
+    QuantumCircuit circuit(num_qubits);
+    for (size_t i = 0; i < num_qubits; ++i) {
+        circuit.h(i);
+        for (size_t j = i + 1; j < num_qubits; ++j) {
+            circuit.cp(j, i, M_PI / (1ULL << (j - i)));
+        }
+    }
+    return circuit;
+}
+
+// Same shape as the single-node random benchmark: seeded, so every rank
+// (and every backend) generates the identical circuit.
+QuantumCircuit make_random(size_t num_qubits, size_t num_gates, uint64_t seed) {
+    QuantumCircuit circuit(num_qubits);
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<size_t> qubit_dist(0, num_qubits - 1);
+    std::uniform_int_distribution<int> gate_dist(0, 4);
+    std::uniform_real_distribution<double> angle_dist(0, 2 * M_PI);
+    for (size_t g = 0; g < num_gates; ++g) {
+        size_t q = qubit_dist(gen);
+        switch (gate_dist(gen)) {
+            case 0: circuit.h(q); break;
+            case 1: circuit.rx(q, angle_dist(gen)); break;
+            case 2: circuit.rz(q, angle_dist(gen)); break;
+            case 3: circuit.x(q); break;
+            default: {
+                size_t t = qubit_dist(gen);
+                if (t == q) {
+                    t = (t + 1) % num_qubits;
+                }
+                circuit.cnot(q, t);
+                break;
+            }
+        }
+    }
+    return circuit;
+}
+
+struct DistributedCase {
+    std::string name;
+    size_t num_qubits;
+    size_t num_gates;
+    double execution_time_ms;
+    size_t num_exchanges;
+    double norm;
+};
+
+DistributedCase run_case(const std::string& name, const QuantumCircuit& circuit,
+                         MPI_Comm comm) {
+    std::vector<Operation> ops = circuit.fused_operations();
+
+    MPI_Barrier(comm);
+    double start = MPI_Wtime();
+    DistributedQuantumState state(circuit.num_qubits(), comm);
+    state.apply(ops);
+    MPI_Barrier(comm);
+    double elapsed_ms = (MPI_Wtime() - start) * 1e3;
+
+    double norm = state.total_norm();
+    OperationArena::release(std::move(ops));
+    return {name, circuit.num_qubits(), circuit.num_operations(),
+            elapsed_ms, state.num_exchanges(), norm};
+}
+
+std::string case_to_json(const DistributedCase& result, int num_ranks) {
+    std::ostringstream oss;
+    oss << "{ \"name\": \"" << result.name << "\","
+        << " \"num_qubits\": " << result.num_qubits << ","
+        << " \"num_gates\": " << result.num_gates << ","
+        << " \"num_ranks\": " << num_ranks << ","
+        << " \"execution_time_ms\": " << std::fixed << std::setprecision(6)
+        << result.execution_time_ms << ","
+        << " \"num_exchanges\": " << result.num_exchanges << ","
+        << " \"norm\": " << std::setprecision(12) << result.norm << " }";
+    return oss.str();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    MPI_Init(&argc, &argv);
+    int rank = 0;
+    int num_ranks = 1;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+    std::vector<size_t> qubit_sizes;
+    uint64_t seed = 12345;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--qubits" && i + 1 < argc) {
+            qubit_sizes.push_back(std::stoul(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        }
+    }
+    if (qubit_sizes.empty()) {
+        qubit_sizes = {16, 20, 24};
+    }
+
+    if (rank == 0) {
+        std::cerr << "Starting distributed benchmarks on " << num_ranks
+                  << " ranks..." << std::endl;
+        std::cout << "[" << std::endl;
+    }
+
+    int status = 0;
+    for (size_t c = 0; c < qubit_sizes.size(); ++c) {
+        size_t num_qubits = qubit_sizes[c];
+        try {
+            DistributedCase ghz = run_case("GHZ-" + std::to_string(num_qubits),
+                                           make_ghz(num_qubits), MPI_COMM_WORLD);
+            DistributedCase qft = run_case("QFT-" + std::to_string(num_qubits),
+                                           make_qft(num_qubits), MPI_COMM_WORLD);
+            DistributedCase rnd = run_case("Random-" + std::to_string(num_qubits),
+                                           make_random(num_qubits, num_qubits * 10, seed),
+                                           MPI_COMM_WORLD);
+            if (rank == 0) {
+                bool last = c + 1 == qubit_sizes.size();
+                std::cout << "  " << case_to_json(ghz, num_ranks) << ",\n"
+                          << "  " << case_to_json(qft, num_ranks) << ",\n"
+                          << "  " << case_to_json(rnd, num_ranks) << (last ? "" : ",")
+                          << std::endl;
+            }
+        } catch (const std::exception& e) {
+            if (rank == 0) {
+                std::cerr << "Error at " << num_qubits << " qubits: " << e.what()
+                          << std::endl;
+            }
+            status = 1;
+            break;
+        }
+    }
+
+    if (rank == 0) {
+        std::cout << "]" << std::endl;
+    }
+    MPI_Finalize();
+    return status;
+}
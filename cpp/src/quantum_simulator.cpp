@@ -1,186 +1,3109 @@
 #include "quantum_simulator.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
+#include <cstring>
+#include <utility>
+#include <map>
+#include <mutex>
+#include <numeric>
 #include <random>
+#include <stdexcept>
+#include <tuple>
+#include <thread>
 #include <fstream>
 #include <sstream>
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <new>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+#if defined(QSIM_PROFILE) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
 const double PI = M_PI;
 
-// QuantumState implementation
-QuantumState::QuantumState(size_t num_qubits) 
-    : num_qubits_(num_qubits) {
+namespace {
+
+bool is_diagonal(const Gate& gate) {
+    return gate(0, 1) == Complex(0, 0) && gate(1, 0) == Complex(0, 0);
+}
+
+bool is_antidiagonal(const Gate& gate) {
+    return gate(0, 0) == Complex(0, 0) && gate(1, 1) == Complex(0, 0);
+}
+
+GateClass classify_gate(const Gate& gate) {
+    if (is_diagonal(gate)) {
+        return GateClass::DIAGONAL;
+    }
+    if (is_antidiagonal(gate)) {
+        return GateClass::PERMUTATION;
+    }
+    return GateClass::GENERAL;
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+bool cpu_has_avx2() {
+    static const bool supported =
+        __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+}
+
+// Multiplies two packed complex doubles [r0, i0, r1, i1] by the scalar
+// complex whose real/imag parts are broadcast in cr/ci.
+inline __m256d complex_mul(__m256d v, __m256d cr, __m256d ci) {
+    __m256d v_swapped = _mm256_permute_pd(v, 0x5);
+    return _mm256_fmaddsub_pd(v, cr, _mm256_mul_pd(v_swapped, ci));
+}
+
+// Butterfly update vectorized across amplitude pairs, two pairs per
+// iteration. Requires qubit >= 1 so the pair halves are contiguous runs.
+void butterfly_avx2(Complex* amps, size_t num_pairs, size_t qubit,
+                    const Gate& gate, bool parallel) {
+    __m256d g00r = _mm256_set1_pd(gate(0, 0).real());
+    __m256d g00i = _mm256_set1_pd(gate(0, 0).imag());
+    __m256d g01r = _mm256_set1_pd(gate(0, 1).real());
+    __m256d g01i = _mm256_set1_pd(gate(0, 1).imag());
+    __m256d g10r = _mm256_set1_pd(gate(1, 0).real());
+    __m256d g10i = _mm256_set1_pd(gate(1, 0).imag());
+    __m256d g11r = _mm256_set1_pd(gate(1, 1).real());
+    __m256d g11i = _mm256_set1_pd(gate(1, 1).imag());
+
+    size_t half = 1ULL << qubit;
+    size_t num_blocks = num_pairs >> qubit;
+
+    // Collapsed so the team splits the full pair count, not the block
+    // count: a high target qubit leaves only one or two blocks, which
+    // would strand all but one or two threads on exactly the strided
+    // sweeps that need the bandwidth most.
+    #pragma omp parallel for collapse(2) if(parallel)
+    for (size_t b = 0; b < num_blocks; ++b) {
+        for (size_t k = 0; k < 2 * half; k += 4) {
+            double* lo = reinterpret_cast<double*>(amps + (b << (qubit + 1)));
+            double* hi = lo + 2 * half;
+
+            __m256d v0 = _mm256_loadu_pd(lo + k);
+            __m256d v1 = _mm256_loadu_pd(hi + k);
+
+            __m256d r0 = _mm256_add_pd(complex_mul(v0, g00r, g00i),
+                                       complex_mul(v1, g01r, g01i));
+            __m256d r1 = _mm256_add_pd(complex_mul(v0, g10r, g10i),
+                                       complex_mul(v1, g11r, g11i));
+
+            _mm256_storeu_pd(lo + k, r0);
+            _mm256_storeu_pd(hi + k, r1);
+        }
+    }
+}
+
+#endif // __AVX2__ && __FMA__
+
+#ifdef __AVX512F__
+
+bool cpu_has_avx512() {
+    static const bool supported = __builtin_cpu_supports("avx512f");
+    return supported;
+}
+
+inline __m512d complex_mul_512(__m512d v, __m512d cr, __m512d ci) {
+    __m512d v_swapped = _mm512_permute_pd(v, 0x55);
+    return _mm512_fmaddsub_pd(v, cr, _mm512_mul_pd(v_swapped, ci));
+}
+
+// Same butterfly as butterfly_avx2 but four pairs per iteration; needs
+// qubit >= 2 so each pair half spans at least one full 512-bit vector.
+void butterfly_avx512(Complex* amps, size_t num_pairs, size_t qubit,
+                      const Gate& gate, bool parallel) {
+    __m512d g00r = _mm512_set1_pd(gate(0, 0).real());
+    __m512d g00i = _mm512_set1_pd(gate(0, 0).imag());
+    __m512d g01r = _mm512_set1_pd(gate(0, 1).real());
+    __m512d g01i = _mm512_set1_pd(gate(0, 1).imag());
+    __m512d g10r = _mm512_set1_pd(gate(1, 0).real());
+    __m512d g10i = _mm512_set1_pd(gate(1, 0).imag());
+    __m512d g11r = _mm512_set1_pd(gate(1, 1).real());
+    __m512d g11i = _mm512_set1_pd(gate(1, 1).imag());
+
+    size_t half = 1ULL << qubit;
+    size_t num_blocks = num_pairs >> qubit;
+
+    // Collapsed for the same reason as butterfly_avx2: thread count must
+    // not degrade to the block count on high target qubits.
+    #pragma omp parallel for collapse(2) if(parallel)
+    for (size_t b = 0; b < num_blocks; ++b) {
+        for (size_t k = 0; k < 2 * half; k += 8) {
+            double* lo = reinterpret_cast<double*>(amps + (b << (qubit + 1)));
+            double* hi = lo + 2 * half;
+
+            __m512d v0 = _mm512_loadu_pd(lo + k);
+            __m512d v1 = _mm512_loadu_pd(hi + k);
+
+            __m512d r0 = _mm512_add_pd(complex_mul_512(v0, g00r, g00i),
+                                       complex_mul_512(v1, g01r, g01i));
+            __m512d r1 = _mm512_add_pd(complex_mul_512(v0, g10r, g10i),
+                                       complex_mul_512(v1, g11r, g11i));
+
+            _mm512_storeu_pd(lo + k, r0);
+            _mm512_storeu_pd(hi + k, r1);
+        }
+    }
+}
+
+#endif // __AVX512F__
+
+} // namespace
+
+// StateBufferPoolT / OperationArena implementation
+namespace {
+
+template <typename Scalar>
+struct StatePoolStorage {
+    std::mutex mutex;
+    std::vector<StateVectorT<Scalar>> buffers;
+};
+
+template <typename Scalar>
+StatePoolStorage<Scalar>& state_pool_storage() {
+    static StatePoolStorage<Scalar> storage;
+    return storage;
+}
+
+std::mutex operation_arena_mutex;
+std::vector<std::vector<Operation>> operation_arena;
+
+} // namespace
+
+template <typename Scalar>
+StateVectorT<Scalar> StateBufferPoolT<Scalar>::acquire(size_t size) {
+    auto& storage = state_pool_storage<Scalar>();
+    {
+        std::lock_guard<std::mutex> lock(storage.mutex);
+        for (auto it = storage.buffers.begin(); it != storage.buffers.end(); ++it) {
+            if (static_cast<size_t>(it->size()) == size) {
+                StateVectorT<Scalar> buffer = std::move(*it);
+                storage.buffers.erase(it);
+                return buffer;
+            }
+        }
+    }
+    // Eigen allocates through raw aligned malloc, invisible to the global
+    // new/delete counters; account for the pool miss explicitly.
+    MemoryTelemetry::record_allocation(size * sizeof(std::complex<Scalar>));
+    return StateVectorT<Scalar>(size);
+}
+
+template <typename Scalar>
+void StateBufferPoolT<Scalar>::release(StateVectorT<Scalar>&& buffer) {
+    if (buffer.size() == 0) {
+        return;
+    }
+    auto& storage = state_pool_storage<Scalar>();
+    std::lock_guard<std::mutex> lock(storage.mutex);
+    storage.buffers.push_back(std::move(buffer));
+}
+
+std::vector<Operation> OperationArena::acquire() {
+    std::lock_guard<std::mutex> lock(operation_arena_mutex);
+    if (operation_arena.empty()) {
+        return {};
+    }
+    std::vector<Operation> operations = std::move(operation_arena.back());
+    operation_arena.pop_back();
+    operations.clear();
+    return operations;
+}
+
+void OperationArena::release(std::vector<Operation>&& operations) {
+    if (operations.capacity() == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(operation_arena_mutex);
+    operation_arena.push_back(std::move(operations));
+}
+
+// MappedStateBufferT implementation
+template <typename Scalar>
+MappedStateBufferT<Scalar>::MappedStateBufferT(size_t size) {
+#ifdef __linux__
+    size_t bytes = size * sizeof(std::complex<Scalar>);
+    char path[] = "/tmp/qsim-state-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return;
+    }
+    unlink(path);  // the mapping keeps the file alive
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        close(fd);
+        return;
+    }
+    void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        return;
+    }
+    madvise(mem, bytes, MADV_SEQUENTIAL);
+    data_ = static_cast<std::complex<Scalar>*>(mem);
+    size_ = size;
+#else
+    (void)size;
+#endif
+}
+
+template <typename Scalar>
+MappedStateBufferT<Scalar>::~MappedStateBufferT() {
+#ifdef __linux__
+    if (data_ != nullptr) {
+        munmap(data_, size_ * sizeof(std::complex<Scalar>));
+    }
+#endif
+}
+
+template <typename Scalar>
+MappedStateBufferT<Scalar>::MappedStateBufferT(MappedStateBufferT&& other) noexcept
+    : data_(other.data_), size_(other.size_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+template <typename Scalar>
+MappedStateBufferT<Scalar>&
+MappedStateBufferT<Scalar>::operator=(MappedStateBufferT&& other) noexcept {
+    if (this != &other) {
+        this->~MappedStateBufferT();
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+template class MappedStateBufferT<double>;
+template class MappedStateBufferT<float>;
+
+// QuantumStateT implementation
+template <typename Scalar>
+QuantumStateT<Scalar>::QuantumStateT(size_t num_qubits)
+    : QuantumStateT(num_qubits, num_qubits >= kMappedThresholdQubits
+                                    ? Backend::MAPPED
+                                    : Backend::HEAP) {}
+
+template <typename Scalar>
+QuantumStateT<Scalar>::QuantumStateT(size_t num_qubits, Backend backend)
+    : QuantumStateT(num_qubits, backend, Placement::FIRST_TOUCH) {}
+
+template <typename Scalar>
+QuantumStateT<Scalar>::QuantumStateT(size_t num_qubits, Backend backend, Placement placement)
+    : amplitudes_(nullptr, 0),
+      num_qubits_(num_qubits),
+      backend_(backend),
+      placement_(placement) {
     size_t size = 1ULL << num_qubits;
-    amplitudes_ = StateVector::Zero(size);
-    amplitudes_(0) = Complex(1.0, 0.0);
+    if (backend_ == Backend::MAPPED) {
+        mapped_ = MappedStateBufferT<Scalar>(size);
+    }
+    if (mapped_.data() != nullptr) {
+        new (&amplitudes_) Eigen::Map<StateVectorT<Scalar>>(mapped_.data(), size);
+    } else {
+        // Mapping unavailable (or heap requested): pool-backed storage.
+        backend_ = Backend::HEAP;
+        heap_ = StateBufferPoolT<Scalar>::acquire(size);
+        new (&amplitudes_) Eigen::Map<StateVectorT<Scalar>>(heap_.data(), size);
+    }
+    reset();
+}
+
+template <typename Scalar>
+QuantumStateT<Scalar>::~QuantumStateT() {
+    StateBufferPoolT<Scalar>::release(std::move(heap_));
+    release_cow_mapping();
+#ifdef __linux__
+    if (snapshot_fd_ >= 0) {
+        close(snapshot_fd_);
+    }
+#endif
+}
+
+template <typename Scalar>
+QuantumStateT<Scalar>::QuantumStateT(const QuantumStateT& other)
+    : QuantumStateT(other.num_qubits_, other.backend_, other.placement_) {
+    amplitudes_ = other.amplitudes_;
+}
+
+template <typename Scalar>
+QuantumStateT<Scalar>& QuantumStateT<Scalar>::operator=(const QuantumStateT& other) {
+    if (this != &other) {
+        QuantumStateT copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+template <typename Scalar>
+QuantumStateT<Scalar>::QuantumStateT(QuantumStateT&& other) noexcept
+    : heap_(std::move(other.heap_)),
+      mapped_(std::move(other.mapped_)),
+      amplitudes_(other.amplitudes_.data(), other.amplitudes_.size()),
+      num_qubits_(other.num_qubits_),
+      backend_(other.backend_),
+      placement_(other.placement_),
+      cow_data_(other.cow_data_),
+      snapshot_fd_(other.snapshot_fd_),
+      snapshot_copy_(std::move(other.snapshot_copy_)) {
+    other.cow_data_ = nullptr;
+    other.snapshot_fd_ = -1;
+    new (&other.amplitudes_) Eigen::Map<StateVectorT<Scalar>>(nullptr, 0);
+}
+
+template <typename Scalar>
+QuantumStateT<Scalar>& QuantumStateT<Scalar>::operator=(QuantumStateT&& other) noexcept {
+    if (this != &other) {
+        StateBufferPoolT<Scalar>::release(std::move(heap_));
+        release_cow_mapping();
+#ifdef __linux__
+        if (snapshot_fd_ >= 0) {
+            close(snapshot_fd_);
+        }
+#endif
+        heap_ = std::move(other.heap_);
+        mapped_ = std::move(other.mapped_);
+        new (&amplitudes_) Eigen::Map<StateVectorT<Scalar>>(other.amplitudes_.data(),
+                                                            other.amplitudes_.size());
+        num_qubits_ = other.num_qubits_;
+        backend_ = other.backend_;
+        placement_ = other.placement_;
+        cow_data_ = other.cow_data_;
+        snapshot_fd_ = other.snapshot_fd_;
+        snapshot_copy_ = std::move(other.snapshot_copy_);
+        other.cow_data_ = nullptr;
+        other.snapshot_fd_ = -1;
+        new (&other.amplitudes_) Eigen::Map<StateVectorT<Scalar>>(nullptr, 0);
+    }
+    return *this;
 }
 
-void QuantumState::apply_single_gate(const Gate& gate, size_t qubit) {
+template <typename Scalar>
+void QuantumStateT<Scalar>::reset() {
     size_t size = amplitudes_.size();
-    StateVector new_amplitudes = amplitudes_;
-    
+    Amplitude* data = amplitudes_.data();
+
+    if (placement_ == Placement::INTERLEAVE) {
+        // Page-granular round-robin: consecutive pages are first-touched by
+        // different threads, so they land on alternating nodes.
+        constexpr size_t kPageAmplitudes = 4096 / sizeof(Amplitude);
+        size_t num_pages = (size + kPageAmplitudes - 1) / kPageAmplitudes;
+        #pragma omp parallel for schedule(static, 1) if(use_parallel_kernel())
+        for (size_t page = 0; page < num_pages; ++page) {
+            size_t begin = page * kPageAmplitudes;
+            size_t end = std::min(size, begin + kPageAmplitudes);
+            std::fill(data + begin, data + end, Amplitude(0, 0));
+        }
+    } else {
+        // Static contiguous chunks, the same partitioning the threaded gate
+        // kernels use, so each thread first-touches the pages it will later
+        // sweep.
+        #pragma omp parallel for if(use_parallel_kernel())
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = Amplitude(0, 0);
+        }
+    }
+
+    data[0] = Amplitude(1.0, 0.0);
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::initialize_product(const std::vector<ProductFactor>& factors) {
+    size_t mask = 0;
+    for (const auto& factor : factors) {
+        Amplitude zero(factor.zero), one(factor.one);
+        size_t qbit = 1ULL << factor.qubit;
+
+        if ((mask & (mask + 1)) == 0 && qbit > mask) {
+            // Filled subspace is the contiguous range [0, mask]: plain
+            // indexed doubling, parallelizable. Factors applied in
+            // ascending qubit order stay on this path.
+            #pragma omp parallel for if(use_parallel_kernel())
+            for (size_t x = 0; x <= mask; ++x) {
+                Amplitude base = amplitudes_(x);
+                amplitudes_(x | qbit) = one * base;
+                amplitudes_(x) = zero * base;
+            }
+        } else {
+            // Sparse qubit set: walk the submasks of the filled bits.
+            size_t x = 0;
+            while (true) {
+                Amplitude base = amplitudes_(x);
+                amplitudes_(x | qbit) = one * base;
+                amplitudes_(x) = zero * base;
+                x = (x - mask) & mask;
+                if (x == 0) {
+                    break;
+                }
+            }
+        }
+        mask |= qbit;
+    }
+}
+
+template <typename Scalar>
+bool QuantumStateT<Scalar>::verification_mode_ = false;
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::set_verification_mode(bool enabled) {
+    verification_mode_ = enabled;
+}
+
+template <typename Scalar>
+bool QuantumStateT<Scalar>::verification_mode() {
+    return verification_mode_;
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::apply_single_gate(const Gate& gate, size_t qubit) {
+    apply_single_gate(gate, qubit, classify_gate(gate));
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::apply_single_gate(const Gate& gate, size_t qubit,
+                                              GateClass gate_class) {
+    if (verification_mode_) {
+        apply_single_gate_copying(gate, qubit);
+        return;
+    }
+
+    if (gate_class == GateClass::DIAGONAL) {
+        apply_diagonal_gate(gate(0, 0), gate(1, 1), qubit);
+        return;
+    }
+    if (gate_class == GateClass::PERMUTATION) {
+        apply_antidiagonal_gate(gate(0, 1), gate(1, 0), qubit);
+        return;
+    }
+
+    // The hand-vectorized kernels work on packed complex doubles; the float
+    // path relies on the compiler vectorizing the generic loop.
+    if constexpr (std::is_same_v<Scalar, double>) {
+#ifdef __AVX512F__
+        if (qubit >= 2 && cpu_has_avx512()) {
+            butterfly_avx512(amplitudes_.data(), amplitudes_.size() >> 1, qubit,
+                             gate, use_parallel_kernel());
+            return;
+        }
+#endif
+#if defined(__AVX2__) && defined(__FMA__)
+        // The vectorized kernels need the pair halves to be contiguous runs
+        // of amplitudes, so qubit 0 stays on the scalar path.
+        if (qubit >= 1 && cpu_has_avx2()) {
+            butterfly_avx2(amplitudes_.data(), amplitudes_.size() >> 1, qubit,
+                           gate, use_parallel_kernel());
+            return;
+        }
+#endif
+    }
+
+    apply_single_gate_generic(gate, qubit);
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::apply_single_gate_generic(const Gate& gate, size_t qubit) {
+    // The butterfly update only touches the (i, j) amplitude pair, so it can
+    // mutate the state vector directly without a full copy. Iterating over
+    // pair indices (all indices with the target bit cleared) gives disjoint
+    // updates, so the loop parallelizes without synchronization.
+    size_t num_pairs = amplitudes_.size() >> 1;
+    size_t low_mask = (1ULL << qubit) - 1;
+    Amplitude g00(gate(0, 0)), g01(gate(0, 1)), g10(gate(1, 0)), g11(gate(1, 1));
+
+    #pragma omp parallel for if(use_parallel_kernel())
+    for (size_t p = 0; p < num_pairs; ++p) {
+        size_t i = ((p >> qubit) << (qubit + 1)) | (p & low_mask);
+        size_t j = i | (1ULL << qubit);
+        Amplitude amp0 = amplitudes_(i);
+        Amplitude amp1 = amplitudes_(j);
+
+        amplitudes_(i) = g00 * amp0 + g01 * amp1;
+        amplitudes_(j) = g10 * amp0 + g11 * amp1;
+    }
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::apply_diagonal_gate(const Complex& d0, const Complex& d1, size_t qubit) {
+    size_t size = amplitudes_.size();
+    Amplitude s0(d0), s1(d1);
+
+    if (d0 == Complex(1.0, 0.0)) {
+        // pauli_z and phase-style gates only scale the |1> amplitudes.
+        #pragma omp parallel for if(use_parallel_kernel())
+        for (size_t i = 0; i < size; ++i) {
+            if ((i >> qubit) & 1) {
+                amplitudes_(i) *= s1;
+            }
+        }
+        return;
+    }
+
+    #pragma omp parallel for if(use_parallel_kernel())
+    for (size_t i = 0; i < size; ++i) {
+        amplitudes_(i) *= ((i >> qubit) & 1) ? s1 : s0;
+    }
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::apply_antidiagonal_gate(const Complex& g01, const Complex& g10, size_t qubit) {
+    size_t num_pairs = amplitudes_.size() >> 1;
+    size_t low_mask = (1ULL << qubit) - 1;
+    bool pure_swap = g01 == Complex(1.0, 0.0) && g10 == Complex(1.0, 0.0);
+    Amplitude s01(g01), s10(g10);
+
+    #pragma omp parallel for if(use_parallel_kernel())
+    for (size_t p = 0; p < num_pairs; ++p) {
+        size_t i = ((p >> qubit) << (qubit + 1)) | (p & low_mask);
+        size_t j = i | (1ULL << qubit);
+
+        if (pure_swap) {
+            std::swap(amplitudes_(i), amplitudes_(j));
+        } else {
+            Amplitude amp0 = amplitudes_(i);
+            amplitudes_(i) = s01 * amplitudes_(j);
+            amplitudes_(j) = s10 * amp0;
+        }
+    }
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::apply_controlled_gate(const Gate& gate, size_t control, size_t target) {
+    if (verification_mode_) {
+        apply_controlled_gate_copying(gate, control, target);
+        return;
+    }
+
+    // Enumerate only the subspace with the control bit set and the target
+    // bit clear (a quarter of the indices) instead of scanning all 2^n
+    // indices and discarding three quarters of them on bit tests.
+    size_t num_iters = amplitudes_.size() >> 2;
+    size_t lo = std::min(control, target);
+    size_t hi = std::max(control, target);
+    size_t control_bit = 1ULL << control;
+    size_t target_bit = 1ULL << target;
+    Amplitude g00(gate(0, 0)), g01(gate(0, 1)), g10(gate(1, 0)), g11(gate(1, 1));
+
+    #pragma omp parallel for if(use_parallel_kernel())
+    for (size_t p = 0; p < num_iters; ++p) {
+        size_t base = ((p >> lo) << (lo + 1)) | (p & ((1ULL << lo) - 1));
+        base = ((base >> hi) << (hi + 1)) | (base & ((1ULL << hi) - 1));
+        size_t i = base | control_bit;
+        size_t j = i | target_bit;
+        Amplitude amp0 = amplitudes_(i);
+        Amplitude amp1 = amplitudes_(j);
+
+        amplitudes_(i) = g00 * amp0 + g01 * amp1;
+        amplitudes_(j) = g10 * amp0 + g11 * amp1;
+    }
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::apply_two_qubit_gate(const Eigen::Matrix4cd& gate, size_t q0, size_t q1) {
+    Eigen::Matrix<Amplitude, 4, 4> m = gate.cast<Amplitude>();
+    size_t num_groups = amplitudes_.size() >> 2;
+    size_t lo = std::min(q0, q1);
+    size_t hi = std::max(q0, q1);
+    size_t bit0 = 1ULL << q0;
+    size_t bit1 = 1ULL << q1;
+
+    #pragma omp parallel for if(use_parallel_kernel())
+    for (size_t p = 0; p < num_groups; ++p) {
+        size_t base = ((p >> lo) << (lo + 1)) | (p & ((1ULL << lo) - 1));
+        base = ((base >> hi) << (hi + 1)) | (base & ((1ULL << hi) - 1));
+        size_t i0 = base;
+        size_t i1 = base | bit0;
+        size_t i2 = base | bit1;
+        size_t i3 = base | bit0 | bit1;
+
+        Amplitude a0 = amplitudes_(i0);
+        Amplitude a1 = amplitudes_(i1);
+        Amplitude a2 = amplitudes_(i2);
+        Amplitude a3 = amplitudes_(i3);
+
+        amplitudes_(i0) = m(0, 0) * a0 + m(0, 1) * a1 + m(0, 2) * a2 + m(0, 3) * a3;
+        amplitudes_(i1) = m(1, 0) * a0 + m(1, 1) * a1 + m(1, 2) * a2 + m(1, 3) * a3;
+        amplitudes_(i2) = m(2, 0) * a0 + m(2, 1) * a1 + m(2, 2) * a2 + m(2, 3) * a3;
+        amplitudes_(i3) = m(3, 0) * a0 + m(3, 1) * a1 + m(3, 2) * a2 + m(3, 3) * a3;
+    }
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::apply_multi_controlled_gate(const Gate& gate,
+                                                        const std::vector<size_t>& controls,
+                                                        size_t target) {
+    std::vector<size_t> positions = controls;
+    positions.push_back(target);
+    std::sort(positions.begin(), positions.end());
+
+    size_t control_mask = 0;
+    for (size_t c : controls) {
+        control_mask |= 1ULL << c;
+    }
+    size_t target_bit = 1ULL << target;
+    size_t num_iters = amplitudes_.size() >> positions.size();
+    Amplitude g00(gate(0, 0)), g01(gate(0, 1)), g10(gate(1, 0)), g11(gate(1, 1));
+
+    #pragma omp parallel for if(use_parallel_kernel())
+    for (size_t p = 0; p < num_iters; ++p) {
+        size_t base = p;
+        for (size_t q : positions) {
+            base = ((base >> q) << (q + 1)) | (base & ((1ULL << q) - 1));
+        }
+        size_t i = base | control_mask;
+        size_t j = i | target_bit;
+        Amplitude amp0 = amplitudes_(i);
+        Amplitude amp1 = amplitudes_(j);
+
+        amplitudes_(i) = g00 * amp0 + g01 * amp1;
+        amplitudes_(j) = g10 * amp0 + g11 * amp1;
+    }
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::apply_controlled_phase(const Complex& phase, size_t control, size_t target) {
+    size_t size = amplitudes_.size();
+    size_t mask = (1ULL << control) | (1ULL << target);
+    Amplitude factor(phase);
+
+    #pragma omp parallel for if(use_parallel_kernel())
+    for (size_t i = 0; i < size; ++i) {
+        if ((i & mask) == mask) {
+            amplitudes_(i) *= factor;
+        }
+    }
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::apply_block_gate(const Eigen::MatrixXcd& gate, const std::vector<size_t>& qubits) {
+    size_t k = qubits.size();
+    size_t dim = 1ULL << k;
+    Eigen::Matrix<Amplitude, Eigen::Dynamic, Eigen::Dynamic> block =
+        gate.cast<Amplitude>();
+
+    // Sub-index bit b of the block corresponds to qubits[b]; offsets[s] is
+    // the global-index contribution of block sub-index s.
+    std::vector<size_t> offsets(dim);
+    for (size_t s = 0; s < dim; ++s) {
+        size_t offset = 0;
+        for (size_t b = 0; b < k; ++b) {
+            if ((s >> b) & 1) {
+                offset |= 1ULL << qubits[b];
+            }
+        }
+        offsets[s] = offset;
+    }
+
+    std::vector<size_t> sorted_qubits = qubits;
+    std::sort(sorted_qubits.begin(), sorted_qubits.end());
+
+    size_t num_groups = amplitudes_.size() >> k;
+
+    #pragma omp parallel for if(use_parallel_kernel())
+    for (size_t g = 0; g < num_groups; ++g) {
+        // Expand the group index by inserting a zero bit at each block qubit
+        // position (ascending order keeps lower insertions stable).
+        size_t base = g;
+        for (size_t q : sorted_qubits) {
+            base = ((base >> q) << (q + 1)) | (base & ((1ULL << q) - 1));
+        }
+
+        Amplitude scratch[1ULL << kMaxBlockQubits];
+        for (size_t s = 0; s < dim; ++s) {
+            scratch[s] = amplitudes_(base | offsets[s]);
+        }
+        for (size_t r = 0; r < dim; ++r) {
+            Amplitude acc(0, 0);
+            for (size_t c = 0; c < dim; ++c) {
+                acc += block(r, c) * scratch[c];
+            }
+            amplitudes_(base | offsets[r]) = acc;
+        }
+    }
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::apply_single_gate_copying(const Gate& gate, size_t qubit) {
+    size_t size = amplitudes_.size();
+    StateVectorT<Scalar> new_amplitudes = amplitudes_;
+    Amplitude g00(gate(0, 0)), g01(gate(0, 1)), g10(gate(1, 0)), g11(gate(1, 1));
+
     for (size_t i = 0; i < size; ++i) {
         if (((i >> qubit) & 1) == 0) {
             size_t j = i | (1ULL << qubit);
             if (j < size) {
-                Complex amp0 = amplitudes_(i);
-                Complex amp1 = amplitudes_(j);
-                
-                new_amplitudes(i) = gate(0, 0) * amp0 + gate(0, 1) * amp1;
-                new_amplitudes(j) = gate(1, 0) * amp0 + gate(1, 1) * amp1;
+                Amplitude amp0 = amplitudes_(i);
+                Amplitude amp1 = amplitudes_(j);
+
+                new_amplitudes(i) = g00 * amp0 + g01 * amp1;
+                new_amplitudes(j) = g10 * amp0 + g11 * amp1;
             }
         }
     }
-    
+
     amplitudes_ = new_amplitudes;
 }
 
-void QuantumState::apply_controlled_gate(const Gate& gate, size_t control, size_t target) {
+template <typename Scalar>
+void QuantumStateT<Scalar>::apply_controlled_gate_copying(const Gate& gate, size_t control, size_t target) {
     size_t size = amplitudes_.size();
-    StateVector new_amplitudes = amplitudes_;
-    
+    StateVectorT<Scalar> new_amplitudes = amplitudes_;
+    Amplitude g00(gate(0, 0)), g01(gate(0, 1)), g10(gate(1, 0)), g11(gate(1, 1));
+
     for (size_t i = 0; i < size; ++i) {
         if (((i >> control) & 1) == 1) {
             if (((i >> target) & 1) == 0) {
                 size_t j = i | (1ULL << target);
                 if (j < size) {
-                    Complex amp0 = amplitudes_(i);
-                    Complex amp1 = amplitudes_(j);
-                    
-                    new_amplitudes(i) = gate(0, 0) * amp0 + gate(0, 1) * amp1;
-                    new_amplitudes(j) = gate(1, 0) * amp0 + gate(1, 1) * amp1;
+                    Amplitude amp0 = amplitudes_(i);
+                    Amplitude amp1 = amplitudes_(j);
+
+                    new_amplitudes(i) = g00 * amp0 + g01 * amp1;
+                    new_amplitudes(j) = g10 * amp0 + g11 * amp1;
                 }
             }
         }
     }
-    
+
     amplitudes_ = new_amplitudes;
 }
 
-double QuantumState::get_probability(size_t state) const {
-    if (state < amplitudes_.size()) {
-        return std::norm(amplitudes_(state));
+template <typename Scalar>
+double QuantumStateT<Scalar>::get_probability(size_t state) const {
+    if (state < static_cast<size_t>(amplitudes_.size())) {
+        return static_cast<double>(std::norm(amplitudes_(state)));
     }
     return 0.0;
 }
 
-// Gates implementation
-Gate Gates::pauli_x() {
-    Gate gate;
-    gate << 0, 1,
-            1, 0;
-    return gate;
+template <typename Scalar>
+double QuantumStateT<Scalar>::expectation(const PauliString& pauli) const {
+    size_t size = amplitudes_.size();
+    size_t flip = pauli.flip_mask();
+    size_t phase_mask = pauli.phase_mask();
+
+    double sum_re = 0.0;
+    double sum_im = 0.0;
+    #pragma omp parallel for reduction(+:sum_re, sum_im) if(use_parallel_kernel())
+    for (size_t i = 0; i < size; ++i) {
+        Complex term = std::conj(Complex(amplitudes_(i ^ flip))) * Complex(amplitudes_(i));
+        double sign = (__builtin_popcountll(i & phase_mask) & 1) ? -1.0 : 1.0;
+        sum_re += sign * term.real();
+        sum_im += sign * term.imag();
+    }
+
+    // Each Y contributes a global factor of i; a Hermitian P leaves only
+    // the real part of the rotated sum.
+    switch (pauli.num_y() & 3) {
+        case 0: return sum_re;
+        case 1: return -sum_im;
+        case 2: return -sum_re;
+        default: return sum_im;
+    }
 }
 
-Gate Gates::pauli_y() {
-    Gate gate;
-    gate << 0, Complex(0, -1),
-            Complex(0, 1), 0;
-    return gate;
+template <typename Scalar>
+void QuantumStateT<Scalar>::probabilities_into(double* out, size_t count) const {
+    size_t n = std::min(count, static_cast<size_t>(amplitudes_.size()));
+    Eigen::Map<Eigen::VectorXd>(out, n) =
+        amplitudes_.head(n).cwiseAbs2().template cast<double>();
 }
 
-Gate Gates::pauli_z() {
-    Gate gate;
-    gate << 1, 0,
-            0, -1;
-    return gate;
+template <typename Scalar>
+void QuantumStateT<Scalar>::permute_qubits(const std::vector<size_t>& to) {
+    size_t fixed_mask = 0;
+    std::vector<std::pair<size_t, size_t>> moved;  // (from, to) bit positions
+    for (size_t p = 0; p < num_qubits_; ++p) {
+        if (to[p] == p) {
+            fixed_mask |= 1ULL << p;
+        } else {
+            moved.emplace_back(p, to[p]);
+        }
+    }
+    if (moved.empty()) {
+        return;
+    }
+
+    size_t size = amplitudes_.size();
+    StateVectorT<Scalar> scratch = StateBufferPoolT<Scalar>::acquire(size);
+    const Amplitude* src = amplitudes_.data();
+    Amplitude* dst = scratch.data();
+    #pragma omp parallel for if(use_parallel_kernel())
+    for (size_t i = 0; i < size; ++i) {
+        size_t j = i & fixed_mask;
+        for (const auto& bit : moved) {
+            j |= ((i >> bit.first) & 1ULL) << bit.second;
+        }
+        dst[j] = src[i];
+    }
+
+    if (heap_.data() == amplitudes_.data()) {
+        // Heap backend: adopt the scratch buffer instead of copying back.
+        StateBufferPoolT<Scalar>::release(std::move(heap_));
+        heap_ = std::move(scratch);
+        new (&amplitudes_) Eigen::Map<StateVectorT<Scalar>>(heap_.data(), size);
+    } else {
+        std::copy(dst, dst + size, amplitudes_.data());
+        StateBufferPoolT<Scalar>::release(std::move(scratch));
+    }
 }
 
-Gate Gates::hadamard() {
-    double inv_sqrt2 = 1.0 / std::sqrt(2.0);
-    Gate gate;
-    gate << inv_sqrt2, inv_sqrt2,
-            inv_sqrt2, -inv_sqrt2;
-    return gate;
+template <typename Scalar>
+std::vector<size_t> QuantumStateT<Scalar>::sample(size_t num_shots, uint64_t seed) const {
+    size_t size = amplitudes_.size();
+    std::vector<double> cumulative(size);
+
+    #pragma omp parallel for if(use_parallel_kernel())
+    for (size_t i = 0; i < size; ++i) {
+        cumulative[i] = static_cast<double>(std::norm(amplitudes_(i)));
+    }
+    std::partial_sum(cumulative.begin(), cumulative.end(), cumulative.begin());
+
+    // The total can drift slightly from 1 through rounding; drawing against
+    // it keeps every shot within range.
+    double total = cumulative.back();
+    std::mt19937_64 gen(seed);
+    std::uniform_real_distribution<double> dist(0.0, total);
+
+    std::vector<size_t> shots(num_shots);
+    for (size_t s = 0; s < num_shots; ++s) {
+        auto it = std::upper_bound(cumulative.begin(), cumulative.end(), dist(gen));
+        shots[s] = std::min(static_cast<size_t>(it - cumulative.begin()), size - 1);
+    }
+    return shots;
+}
+
+// Checkpoint / snapshot support
+
+namespace {
+
+// Checkpoint file layout: one page of header followed by the raw
+// amplitude array, so the payload starts page-aligned and load() can
+// hand it straight to mmap.
+constexpr char kCheckpointMagic[8] = {'Q', 'S', 'I', 'M', 'C', 'K', 'P', 'T'};
+constexpr uint32_t kCheckpointVersion = 1;
+constexpr size_t kCheckpointHeaderBytes = 4096;
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t amplitude_bytes;
+    uint64_t num_qubits;
+};
+
+}  // namespace
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot open checkpoint file for writing: " + path);
+    }
+
+    std::vector<char> header(kCheckpointHeaderBytes, 0);
+    CheckpointHeader h = {};
+    std::memcpy(h.magic, kCheckpointMagic, sizeof(kCheckpointMagic));
+    h.version = kCheckpointVersion;
+    h.amplitude_bytes = sizeof(Amplitude);
+    h.num_qubits = num_qubits_;
+    std::memcpy(header.data(), &h, sizeof(h));
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    out.write(reinterpret_cast<const char*>(amplitudes_.data()),
+              static_cast<std::streamsize>(amplitudes_.size() * sizeof(Amplitude)));
+    if (!out) {
+        throw std::runtime_error("Short write to checkpoint file: " + path);
+    }
+}
+
+template <typename Scalar>
+QuantumStateT<Scalar> QuantumStateT<Scalar>::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open checkpoint file: " + path);
+    }
+    CheckpointHeader h = {};
+    in.read(reinterpret_cast<char*>(&h), sizeof(h));
+    if (!in || std::memcmp(h.magic, kCheckpointMagic, sizeof(kCheckpointMagic)) != 0) {
+        throw std::runtime_error("Not a state checkpoint: " + path);
+    }
+    if (h.version != kCheckpointVersion) {
+        throw std::runtime_error("Unsupported checkpoint version in " + path);
+    }
+    if (h.amplitude_bytes != sizeof(Amplitude)) {
+        throw std::runtime_error("Checkpoint precision does not match this state type: " + path);
+    }
+
+    size_t num_qubits = static_cast<size_t>(h.num_qubits);
+    size_t bytes = (1ULL << num_qubits) * sizeof(Amplitude);
+
+#ifdef __linux__
+    // Fast path: map the payload copy-on-write straight out of the file.
+    // Nothing is read or copied up front - pages fault in on first touch,
+    // and only the pages the caller subsequently writes are duplicated.
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        // Mapping past EOF would defer the failure to a SIGBUS on first
+        // touch; reject short files up front like the read path does.
+        struct stat st = {};
+        if (fstat(fd, &st) == 0 &&
+            static_cast<size_t>(st.st_size) < kCheckpointHeaderBytes + bytes) {
+            close(fd);
+            throw std::runtime_error("Truncated checkpoint file: " + path);
+        }
+        void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                         static_cast<off_t>(kCheckpointHeaderBytes));
+        close(fd);
+        if (mem != MAP_FAILED) {
+            return QuantumStateT(num_qubits, static_cast<Amplitude*>(mem));
+        }
+    }
+#endif
+
+    // Fallback: allocate ordinary storage and read the payload into it.
+    QuantumStateT state(num_qubits);
+    in.seekg(static_cast<std::streamoff>(kCheckpointHeaderBytes));
+    in.read(reinterpret_cast<char*>(state.amplitudes_.data()),
+            static_cast<std::streamsize>(bytes));
+    if (!in) {
+        throw std::runtime_error("Truncated checkpoint file: " + path);
+    }
+    return state;
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::snapshot() {
+    size_t bytes = static_cast<size_t>(amplitudes_.size()) * sizeof(Amplitude);
+#ifdef __linux__
+    // Unlinked scratch file, as in MappedStateBufferT: it vanishes with
+    // the last descriptor and restore() can map it MAP_PRIVATE.
+    char tmp_path[] = "/tmp/qsim-snap-XXXXXX";
+    int fd = mkstemp(tmp_path);
+    if (fd >= 0) {
+        unlink(tmp_path);
+        const char* src = reinterpret_cast<const char*>(amplitudes_.data());
+        size_t written = 0;
+        while (written < bytes) {
+            ssize_t n = pwrite(fd, src + written, bytes - written,
+                               static_cast<off_t>(written));
+            if (n <= 0) {
+                break;
+            }
+            written += static_cast<size_t>(n);
+        }
+        if (written == bytes) {
+            if (snapshot_fd_ >= 0) {
+                close(snapshot_fd_);
+            }
+            snapshot_fd_ = fd;
+            snapshot_copy_.resize(0);
+            return;
+        }
+        close(fd);
+    }
+#endif
+    // Fallback (scratch space exhausted, non-Linux): plain deep copy.
+    snapshot_copy_ = amplitudes_;
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::restore() {
+#ifdef __linux__
+    if (snapshot_fd_ >= 0) {
+        size_t bytes = (1ULL << num_qubits_) * sizeof(Amplitude);
+        void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                         snapshot_fd_, 0);
+        if (mem != MAP_FAILED) {
+            adopt_cow_mapping(static_cast<Amplitude*>(mem));
+            return;
+        }
+        // Mapping failed (address space exhausted): read the file back.
+        char* dst = reinterpret_cast<char*>(amplitudes_.data());
+        size_t done = 0;
+        while (done < bytes) {
+            ssize_t n = pread(snapshot_fd_, dst + done, bytes - done,
+                              static_cast<off_t>(done));
+            if (n <= 0) {
+                throw std::runtime_error("Failed to read state snapshot back");
+            }
+            done += static_cast<size_t>(n);
+        }
+        return;
+    }
+#endif
+    if (snapshot_copy_.size() > 0) {
+        amplitudes_ = snapshot_copy_;
+        return;
+    }
+    throw std::runtime_error("restore() called without a prior snapshot()");
+}
+
+template <typename Scalar>
+QuantumStateT<Scalar>::QuantumStateT(size_t num_qubits, Amplitude* cow_data)
+    : amplitudes_(cow_data, static_cast<Eigen::Index>(1ULL << num_qubits)),
+      num_qubits_(num_qubits),
+      // Informational only: the policy a state of this width would pick.
+      backend_(num_qubits >= kMappedThresholdQubits ? Backend::MAPPED : Backend::HEAP),
+      placement_(Placement::FIRST_TOUCH),
+      cow_data_(cow_data) {}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::adopt_cow_mapping(Amplitude* data) {
+    StateBufferPoolT<Scalar>::release(std::move(heap_));
+    mapped_ = MappedStateBufferT<Scalar>();
+    release_cow_mapping();
+    cow_data_ = data;
+    new (&amplitudes_) Eigen::Map<StateVectorT<Scalar>>(
+        data, static_cast<Eigen::Index>(1ULL << num_qubits_));
+}
+
+template <typename Scalar>
+void QuantumStateT<Scalar>::release_cow_mapping() {
+#ifdef __linux__
+    if (cow_data_ != nullptr) {
+        munmap(cow_data_, (1ULL << num_qubits_) * sizeof(Amplitude));
+    }
+#endif
+    cow_data_ = nullptr;
+}
+
+template class StateBufferPoolT<double>;
+template class StateBufferPoolT<float>;
+template class QuantumStateT<double>;
+template class QuantumStateT<float>;
+
+// PauliString implementation
+PauliString::PauliString(const std::string& paulis)
+    : flip_mask_(0), phase_mask_(0), num_y_(0) {
+    for (size_t q = 0; q < paulis.size(); ++q) {
+        switch (paulis[q]) {
+            case 'X':
+                flip_mask_ |= 1ULL << q;
+                break;
+            case 'Y':
+                flip_mask_ |= 1ULL << q;
+                phase_mask_ |= 1ULL << q;
+                ++num_y_;
+                break;
+            case 'Z':
+                phase_mask_ |= 1ULL << q;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// SparseQuantumStateT implementation
+template <typename Scalar>
+SparseQuantumStateT<Scalar>::SparseQuantumStateT(size_t num_qubits)
+    : num_qubits_(num_qubits) {
+    amplitudes_[0] = Amplitude(1.0, 0.0);
+}
+
+template <typename Scalar>
+void SparseQuantumStateT<Scalar>::apply(const std::vector<Operation>& ops) {
+    for (const Operation& op : ops) {
+        apply_operation(op);
+    }
+}
+
+template <typename Scalar>
+void SparseQuantumStateT<Scalar>::apply_operation(const Operation& op) {
+    switch (op.type) {
+        case Operation::SINGLE_GATE:
+            apply_single_gate(op.gate, op.qubit, op.gate_class);
+            break;
+        case Operation::CONTROLLED_PHASE:
+            apply_controlled_phase(op.gate(1, 1), op.control, op.target);
+            break;
+        case Operation::CONTROLLED_GATE:
+            apply_controlled_gate(op.gate, op.control, op.target);
+            break;
+        case Operation::MULTI_CONTROLLED_GATE:
+            apply_multi_controlled_gate(op.gate, op.controls, op.target);
+            break;
+        case Operation::TWO_QUBIT_GATE:
+            apply_two_qubit_gate(op.two_qubit_gate, op.control, op.target);
+            break;
+    }
+}
+
+template <typename Scalar>
+void SparseQuantumStateT<Scalar>::insert_pruned(AmplitudeMap& amps, size_t index,
+                                                const Amplitude& value) const {
+    if (std::norm(value) > kPruneThreshold * kPruneThreshold) {
+        amps[index] = value;
+    }
+}
+
+template <typename Scalar>
+void SparseQuantumStateT<Scalar>::promote_if_dense() {
+    if (dense_) {
+        return;
+    }
+    size_t threshold = static_cast<size_t>(
+        static_cast<double>(1ULL << num_qubits_) * kPromoteDensity);
+    if (amplitudes_.size() < std::max<size_t>(threshold, 2)) {
+        return;
+    }
+    dense_ = std::make_unique<QuantumStateT<Scalar>>(num_qubits_);
+    Amplitude* data = dense_->data();
+    data[0] = Amplitude(0.0, 0.0);  // the constructor put |0...0> there
+    for (const auto& entry : amplitudes_) {
+        data[entry.first] = entry.second;
+    }
+    amplitudes_.clear();
+}
+
+template <typename Scalar>
+void SparseQuantumStateT<Scalar>::apply_single_gate(const Gate& gate, size_t qubit) {
+    apply_single_gate(gate, qubit, classify_gate(gate));
+}
+
+template <typename Scalar>
+void SparseQuantumStateT<Scalar>::apply_single_gate(const Gate& gate, size_t qubit,
+                                                    GateClass gate_class) {
+    if (dense_) {
+        dense_->apply_single_gate(gate, qubit, gate_class);
+        return;
+    }
+    size_t bit = 1ULL << qubit;
+
+    if (gate_class == GateClass::DIAGONAL) {
+        // Keys are unchanged: scale in place, nonzero count is constant.
+        Amplitude d0(gate(0, 0)), d1(gate(1, 1));
+        for (auto& entry : amplitudes_) {
+            entry.second *= (entry.first & bit) ? d1 : d0;
+        }
+        return;
+    }
+
+    if (gate_class == GateClass::PERMUTATION) {
+        // A scaled relabeling of the keys: still no growth.
+        Amplitude s01(gate(0, 1)), s10(gate(1, 0));
+        AmplitudeMap next;
+        next.reserve(amplitudes_.size());
+        for (const auto& entry : amplitudes_) {
+            next.emplace(entry.first ^ bit,
+                         (entry.first & bit) ? s01 * entry.second : s10 * entry.second);
+        }
+        amplitudes_ = std::move(next);
+        return;
+    }
+
+    // General butterfly: each occupied pair is visited once, from its
+    // target-clear member (or the target-set member when it is alone).
+    Amplitude g00(gate(0, 0)), g01(gate(0, 1)), g10(gate(1, 0)), g11(gate(1, 1));
+    AmplitudeMap next;
+    next.reserve(amplitudes_.size() * 2);
+    for (const auto& entry : amplitudes_) {
+        size_t i0 = entry.first & ~bit;
+        if ((entry.first & bit) && amplitudes_.count(i0)) {
+            continue;
+        }
+        auto partner = amplitudes_.find(i0 | bit);
+        Amplitude a0 = (entry.first & bit) ? Amplitude(0.0, 0.0) : entry.second;
+        Amplitude a1 = (entry.first & bit)
+                           ? entry.second
+                           : (partner != amplitudes_.end() ? partner->second
+                                                           : Amplitude(0.0, 0.0));
+        insert_pruned(next, i0, g00 * a0 + g01 * a1);
+        insert_pruned(next, i0 | bit, g10 * a0 + g11 * a1);
+    }
+    amplitudes_ = std::move(next);
+    promote_if_dense();
+}
+
+template <typename Scalar>
+void SparseQuantumStateT<Scalar>::apply_controlled_gate(const Gate& gate, size_t control,
+                                                        size_t target) {
+    if (dense_) {
+        dense_->apply_controlled_gate(gate, control, target);
+        return;
+    }
+    size_t control_bit = 1ULL << control;
+    size_t target_bit = 1ULL << target;
+    Amplitude g00(gate(0, 0)), g01(gate(0, 1)), g10(gate(1, 0)), g11(gate(1, 1));
+
+    AmplitudeMap next;
+    next.reserve(amplitudes_.size() * 2);
+    for (const auto& entry : amplitudes_) {
+        if (!(entry.first & control_bit)) {
+            next.insert(entry);
+            continue;
+        }
+        size_t i0 = entry.first & ~target_bit;
+        if ((entry.first & target_bit) && amplitudes_.count(i0)) {
+            continue;
+        }
+        auto partner = amplitudes_.find(i0 | target_bit);
+        Amplitude a0 = (entry.first & target_bit) ? Amplitude(0.0, 0.0) : entry.second;
+        Amplitude a1 = (entry.first & target_bit)
+                           ? entry.second
+                           : (partner != amplitudes_.end() ? partner->second
+                                                           : Amplitude(0.0, 0.0));
+        insert_pruned(next, i0, g00 * a0 + g01 * a1);
+        insert_pruned(next, i0 | target_bit, g10 * a0 + g11 * a1);
+    }
+    amplitudes_ = std::move(next);
+    promote_if_dense();
+}
+
+template <typename Scalar>
+void SparseQuantumStateT<Scalar>::apply_controlled_phase(const Complex& phase, size_t control,
+                                                         size_t target) {
+    if (dense_) {
+        dense_->apply_controlled_phase(phase, control, target);
+        return;
+    }
+    size_t mask = (1ULL << control) | (1ULL << target);
+    Amplitude factor(phase);
+    for (auto& entry : amplitudes_) {
+        if ((entry.first & mask) == mask) {
+            entry.second *= factor;
+        }
+    }
+}
+
+template <typename Scalar>
+void SparseQuantumStateT<Scalar>::apply_multi_controlled_gate(
+    const Gate& gate, const std::vector<size_t>& controls, size_t target) {
+    if (dense_) {
+        dense_->apply_multi_controlled_gate(gate, controls, target);
+        return;
+    }
+    size_t control_mask = 0;
+    for (size_t c : controls) {
+        control_mask |= 1ULL << c;
+    }
+    size_t target_bit = 1ULL << target;
+    Amplitude g00(gate(0, 0)), g01(gate(0, 1)), g10(gate(1, 0)), g11(gate(1, 1));
+
+    AmplitudeMap next;
+    next.reserve(amplitudes_.size() * 2);
+    for (const auto& entry : amplitudes_) {
+        if ((entry.first & control_mask) != control_mask) {
+            next.insert(entry);
+            continue;
+        }
+        size_t i0 = entry.first & ~target_bit;
+        if ((entry.first & target_bit) && amplitudes_.count(i0)) {
+            continue;
+        }
+        auto partner = amplitudes_.find(i0 | target_bit);
+        Amplitude a0 = (entry.first & target_bit) ? Amplitude(0.0, 0.0) : entry.second;
+        Amplitude a1 = (entry.first & target_bit)
+                           ? entry.second
+                           : (partner != amplitudes_.end() ? partner->second
+                                                           : Amplitude(0.0, 0.0));
+        insert_pruned(next, i0, g00 * a0 + g01 * a1);
+        insert_pruned(next, i0 | target_bit, g10 * a0 + g11 * a1);
+    }
+    amplitudes_ = std::move(next);
+    promote_if_dense();
+}
+
+template <typename Scalar>
+void SparseQuantumStateT<Scalar>::apply_two_qubit_gate(const Eigen::Matrix4cd& gate,
+                                                       size_t q0, size_t q1) {
+    if (dense_) {
+        dense_->apply_two_qubit_gate(gate, q0, q1);
+        return;
+    }
+    Eigen::Matrix<Amplitude, 4, 4> m = gate.cast<Amplitude>();
+    size_t bit0 = 1ULL << q0;
+    size_t bit1 = 1ULL << q1;
+
+    AmplitudeMap next;
+    next.reserve(amplitudes_.size() * 2);
+    for (const auto& entry : amplitudes_) {
+        size_t base = entry.first & ~(bit0 | bit1);
+        size_t sub = ((entry.first & bit0) ? 1 : 0) | ((entry.first & bit1) ? 2 : 0);
+        size_t group[4] = {base, base | bit0, base | bit1, base | bit0 | bit1};
+
+        // Each occupied quad is expanded once, from its lowest occupied
+        // sub-index.
+        bool handled = false;
+        for (size_t k = 0; k < sub; ++k) {
+            if (amplitudes_.count(group[k])) {
+                handled = true;
+                break;
+            }
+        }
+        if (handled) {
+            continue;
+        }
+
+        Amplitude a[4];
+        for (size_t k = 0; k < 4; ++k) {
+            auto it = amplitudes_.find(group[k]);
+            a[k] = it != amplitudes_.end() ? it->second : Amplitude(0.0, 0.0);
+        }
+        for (size_t r = 0; r < 4; ++r) {
+            insert_pruned(next, group[r],
+                          m(r, 0) * a[0] + m(r, 1) * a[1] + m(r, 2) * a[2] + m(r, 3) * a[3]);
+        }
+    }
+    amplitudes_ = std::move(next);
+    promote_if_dense();
+}
+
+template <typename Scalar>
+double SparseQuantumStateT<Scalar>::get_probability(size_t state) const {
+    if (dense_) {
+        return dense_->get_probability(state);
+    }
+    auto it = amplitudes_.find(state);
+    return it != amplitudes_.end() ? static_cast<double>(std::norm(it->second)) : 0.0;
+}
+
+template <typename Scalar>
+size_t SparseQuantumStateT<Scalar>::num_nonzero() const {
+    return dense_ ? dense_->size() : amplitudes_.size();
+}
+
+template class SparseQuantumStateT<double>;
+template class SparseQuantumStateT<float>;
+
+// Gates implementation
+Gate Gates::pauli_x() {
+    Gate gate;
+    gate << 0, 1,
+            1, 0;
+    return gate;
+}
+
+Gate Gates::pauli_y() {
+    Gate gate;
+    gate << 0, Complex(0, -1),
+            Complex(0, 1), 0;
+    return gate;
+}
+
+Gate Gates::pauli_z() {
+    Gate gate;
+    gate << 1, 0,
+            0, -1;
+    return gate;
+}
+
+Gate Gates::hadamard() {
+    double inv_sqrt2 = 1.0 / std::sqrt(2.0);
+    Gate gate;
+    gate << inv_sqrt2, inv_sqrt2,
+            inv_sqrt2, -inv_sqrt2;
+    return gate;
+}
+
+Gate Gates::rx(double theta) {
+    double cos_half = std::cos(theta / 2.0);
+    double sin_half = std::sin(theta / 2.0);
+    
+    Gate gate;
+    gate << cos_half, Complex(0, -sin_half),
+            Complex(0, -sin_half), cos_half;
+    return gate;
+}
+
+Gate Gates::ry(double theta) {
+    double cos_half = std::cos(theta / 2.0);
+    double sin_half = std::sin(theta / 2.0);
+    
+    Gate gate;
+    gate << cos_half, -sin_half,
+            sin_half, cos_half;
+    return gate;
+}
+
+Gate Gates::rz(double theta) {
+    Complex exp_neg = std::exp(Complex(0, -theta / 2.0));
+    Complex exp_pos = std::exp(Complex(0, theta / 2.0));
+    
+    Gate gate;
+    gate << exp_neg, 0,
+            0, exp_pos;
+    return gate;
+}
+
+Gate Gates::phase(double theta) {
+    Gate gate;
+    gate << 1, 0,
+            0, std::exp(Complex(0, theta));
+    return gate;
+}
+
+// QuantumCircuit implementation
+QuantumCircuit::QuantumCircuit(size_t num_qubits)
+    : num_qubits_(num_qubits), operations_(OperationArena::acquire()) {}
+
+QuantumCircuit::~QuantumCircuit() {
+    OperationArena::release(std::move(operations_));
+}
+
+QuantumCircuit& QuantumCircuit::h(size_t qubit) {
+    Gate gate = Gates::hadamard();
+    operations_.push_back({Operation::SINGLE_GATE, gate, qubit, 0, 0, {},
+                           Eigen::Matrix4cd(), classify_gate(gate)});
+    return *this;
+}
+
+QuantumCircuit& QuantumCircuit::x(size_t qubit) {
+    Gate gate = Gates::pauli_x();
+    operations_.push_back({Operation::SINGLE_GATE, gate, qubit, 0, 0, {},
+                           Eigen::Matrix4cd(), classify_gate(gate)});
+    return *this;
+}
+
+QuantumCircuit& QuantumCircuit::y(size_t qubit) {
+    Gate gate = Gates::pauli_y();
+    operations_.push_back({Operation::SINGLE_GATE, gate, qubit, 0, 0, {},
+                           Eigen::Matrix4cd(), classify_gate(gate)});
+    return *this;
+}
+
+QuantumCircuit& QuantumCircuit::z(size_t qubit) {
+    Gate gate = Gates::pauli_z();
+    operations_.push_back({Operation::SINGLE_GATE, gate, qubit, 0, 0, {},
+                           Eigen::Matrix4cd(), classify_gate(gate)});
+    return *this;
+}
+
+QuantumCircuit& QuantumCircuit::rx(size_t qubit, double theta) {
+    Gate gate = Gates::rx(theta);
+    operations_.push_back({Operation::SINGLE_GATE, gate, qubit, 0, 0, {},
+                           Eigen::Matrix4cd(), classify_gate(gate),
+                           Operation::Rotation::RX, theta});
+    return *this;
+}
+
+QuantumCircuit& QuantumCircuit::ry(size_t qubit, double theta) {
+    Gate gate = Gates::ry(theta);
+    operations_.push_back({Operation::SINGLE_GATE, gate, qubit, 0, 0, {},
+                           Eigen::Matrix4cd(), classify_gate(gate),
+                           Operation::Rotation::RY, theta});
+    return *this;
+}
+
+QuantumCircuit& QuantumCircuit::rz(size_t qubit, double theta) {
+    Gate gate = Gates::rz(theta);
+    operations_.push_back({Operation::SINGLE_GATE, gate, qubit, 0, 0, {},
+                           Eigen::Matrix4cd(), classify_gate(gate),
+                           Operation::Rotation::RZ, theta});
+    return *this;
+}
+
+QuantumCircuit& QuantumCircuit::cnot(size_t control, size_t target) {
+    operations_.push_back({Operation::CONTROLLED_GATE, Gates::pauli_x(), 0, control, target});
+    return *this;
+}
+
+QuantumCircuit& QuantumCircuit::cp(size_t control, size_t target, double theta) {
+    operations_.push_back({Operation::CONTROLLED_PHASE, Gates::phase(theta), 0, control, target});
+    return *this;
+}
+
+QuantumCircuit& QuantumCircuit::cgate(const Gate& gate, size_t control, size_t target) {
+    operations_.push_back({Operation::CONTROLLED_GATE, gate, 0, control, target});
+    return *this;
+}
+
+QuantumCircuit& QuantumCircuit::ccx(size_t control1, size_t control2, size_t target) {
+    operations_.push_back({Operation::MULTI_CONTROLLED_GATE, Gates::pauli_x(), 0, 0, target,
+                           {control1, control2}});
+    return *this;
+}
+
+QuantumCircuit& QuantumCircuit::gate2(const Eigen::Matrix4cd& gate, size_t q1, size_t q2) {
+    operations_.push_back({Operation::TWO_QUBIT_GATE, Gate(), 0, q1, q2, {}, gate});
+    return *this;
+}
+
+std::vector<Operation> QuantumCircuit::fused_operations() const {
+    std::vector<Operation> fused = OperationArena::acquire();
+    fused.reserve(operations_.size());
+
+    std::vector<Gate> pending(num_qubits_, Gate::Identity());
+    std::vector<bool> has_pending(num_qubits_, false);
+
+    auto flush = [&](size_t qubit) {
+        if (!has_pending[qubit]) {
+            return;
+        }
+        if (!pending[qubit].isApprox(Gate::Identity())) {
+            // The fused product can gain or lose structure relative to its
+            // factors, so it is re-classified once here.
+            fused.push_back({Operation::SINGLE_GATE, pending[qubit], qubit, 0, 0, {},
+                             Eigen::Matrix4cd(), classify_gate(pending[qubit])});
+        }
+        pending[qubit] = Gate::Identity();
+        has_pending[qubit] = false;
+    };
+
+    for (const auto& op : operations_) {
+        if (op.type == Operation::SINGLE_GATE) {
+            pending[op.qubit] = op.gate * pending[op.qubit];
+            has_pending[op.qubit] = true;
+        } else {
+            if (op.type == Operation::MULTI_CONTROLLED_GATE) {
+                for (size_t c : op.controls) {
+                    flush(c);
+                }
+            } else {
+                flush(op.control);
+            }
+            flush(op.target);
+            fused.push_back(op);
+        }
+    }
+
+    for (size_t q = 0; q < num_qubits_; ++q) {
+        flush(q);
+    }
+
+    return fused;
+}
+
+namespace {
+
+#ifdef QSIM_PROFILE
+
+struct ProfileBucket {
+    size_t calls = 0;
+    uint64_t cycles = 0;
+    double time_ns = 0.0;
+    size_t amplitudes = 0;
+    size_t bytes = 0;
+};
+
+std::mutex profile_mutex;
+std::map<std::string, ProfileBucket> profile_buckets;
+
+uint64_t profile_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Classifies an operation the way the kernels dispatch it, so the report
+// separates e.g. diagonal single gates from full butterflies.
+std::string profile_kind(const Operation& op) {
+    switch (op.type) {
+        case Operation::SINGLE_GATE:
+            if (is_diagonal(op.gate)) {
+                return "single:diagonal";
+            }
+            if (is_antidiagonal(op.gate)) {
+                return "single:antidiagonal";
+            }
+            return "single:generic";
+        case Operation::CONTROLLED_PHASE:
+            return "controlled_phase";
+        case Operation::CONTROLLED_GATE:
+            return "controlled";
+        case Operation::MULTI_CONTROLLED_GATE:
+            return "multi_controlled";
+        case Operation::TWO_QUBIT_GATE:
+            return "two_qubit";
+    }
+    return "unknown";
+}
+
+// Amplitudes an operation loads and stores: structured gates only visit
+// the subspace their controls select.
+size_t profile_amplitudes(const Operation& op, size_t state_size) {
+    switch (op.type) {
+        case Operation::CONTROLLED_PHASE:
+            return state_size / 4;
+        case Operation::CONTROLLED_GATE:
+            return state_size / 2;
+        case Operation::MULTI_CONTROLLED_GATE:
+            return state_size >> op.controls.size();
+        default:
+            return state_size;
+    }
+}
+
+void profile_record(const std::string& kind, uint64_t cycles, double time_ns,
+                    size_t amplitudes, size_t bytes) {
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    ProfileBucket& bucket = profile_buckets[kind];
+    ++bucket.calls;
+    bucket.cycles += cycles;
+    bucket.time_ns += time_ns;
+    bucket.amplitudes += amplitudes;
+    bucket.bytes += bytes;
+}
+
+#endif // QSIM_PROFILE
+
+template <typename Scalar>
+void apply_operation(QuantumStateT<Scalar>& state, const Operation& op) {
+#ifdef QSIM_PROFILE
+    uint64_t start_cycles = profile_cycles();
+    auto start = std::chrono::steady_clock::now();
+#endif
+    switch (op.type) {
+        case Operation::SINGLE_GATE:
+            state.apply_single_gate(op.gate, op.qubit, op.gate_class);
+            break;
+        case Operation::CONTROLLED_PHASE:
+            state.apply_controlled_phase(op.gate(1, 1), op.control, op.target);
+            break;
+        case Operation::CONTROLLED_GATE:
+            state.apply_controlled_gate(op.gate, op.control, op.target);
+            break;
+        case Operation::MULTI_CONTROLLED_GATE:
+            state.apply_multi_controlled_gate(op.gate, op.controls, op.target);
+            break;
+        case Operation::TWO_QUBIT_GATE:
+            state.apply_two_qubit_gate(op.two_qubit_gate, op.control, op.target);
+            break;
+    }
+#ifdef QSIM_PROFILE
+    auto end = std::chrono::steady_clock::now();
+    size_t amplitudes = profile_amplitudes(op, state.size());
+    profile_record(
+        profile_kind(op), profile_cycles() - start_cycles,
+        static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()),
+        amplitudes, amplitudes * 2 * sizeof(std::complex<Scalar>));
+#endif
+}
+
+// A group of operations collected onto a common qubit set, accumulated as
+// one 2^k x 2^k matrix for QuantumState::apply_block_gate. Sub-index bit b
+// of the block matrix addresses qubits[b].
+struct GateBlock {
+    std::vector<size_t> qubits;
+    Eigen::MatrixXcd matrix;
+    std::vector<Operation> ops;
+
+    size_t position_of(size_t qubit) const {
+        for (size_t b = 0; b < qubits.size(); ++b) {
+            if (qubits[b] == qubit) {
+                return b;
+            }
+        }
+        return qubits.size();
+    }
+
+    // Appends a qubit to the block, extending the accumulated matrix with an
+    // identity on the new (most significant) sub-index bit.
+    void add_qubit(size_t qubit) {
+        size_t old_dim = 1ULL << qubits.size();
+        qubits.push_back(qubit);
+
+        Eigen::MatrixXcd extended = Eigen::MatrixXcd::Zero(2 * old_dim, 2 * old_dim);
+        extended.topLeftCorner(old_dim, old_dim) = matrix;
+        extended.bottomRightCorner(old_dim, old_dim) = matrix;
+        matrix = std::move(extended);
+    }
+
+    void absorb(const Operation& op) {
+        size_t dim = matrix.rows();
+        Eigen::MatrixXcd embedded = Eigen::MatrixXcd::Zero(dim, dim);
+
+        if (op.type == Operation::SINGLE_GATE) {
+            size_t pos = position_of(op.qubit);
+            for (size_t c = 0; c < dim; ++c) {
+                size_t cbit = (c >> pos) & 1;
+                for (size_t rbit = 0; rbit < 2; ++rbit) {
+                    size_t r = (c & ~(1ULL << pos)) | (rbit << pos);
+                    embedded(r, c) = op.gate(rbit, cbit);
+                }
+            }
+        } else if (op.type == Operation::TWO_QUBIT_GATE) {
+            size_t p0 = position_of(op.control);
+            size_t p1 = position_of(op.target);
+            size_t pair_mask = (1ULL << p0) | (1ULL << p1);
+            for (size_t c = 0; c < dim; ++c) {
+                size_t cin = ((c >> p0) & 1) | (((c >> p1) & 1) << 1);
+                for (size_t rin = 0; rin < 4; ++rin) {
+                    size_t r = (c & ~pair_mask) | ((rin & 1) << p0) | ((rin >> 1) << p1);
+                    embedded(r, c) = op.two_qubit_gate(rin, cin);
+                }
+            }
+        } else {
+            size_t control_mask = 0;
+            if (op.type == Operation::MULTI_CONTROLLED_GATE) {
+                for (size_t ctrl : op.controls) {
+                    control_mask |= 1ULL << position_of(ctrl);
+                }
+            } else {
+                control_mask = 1ULL << position_of(op.control);
+            }
+            size_t pt = position_of(op.target);
+            for (size_t c = 0; c < dim; ++c) {
+                if ((c & control_mask) != control_mask) {
+                    embedded(c, c) = Complex(1, 0);
+                    continue;
+                }
+                size_t cbit = (c >> pt) & 1;
+                for (size_t rbit = 0; rbit < 2; ++rbit) {
+                    size_t r = (c & ~(1ULL << pt)) | (rbit << pt);
+                    embedded(r, c) = op.gate(rbit, cbit);
+                }
+            }
+        }
+
+        matrix = embedded * matrix;
+        ops.push_back(op);
+    }
+
+    void reset() {
+        qubits.clear();
+        matrix.resize(0, 0);
+        ops.clear();
+    }
+};
+
+std::vector<size_t> operation_support(const Operation& op) {
+    if (op.type == Operation::SINGLE_GATE) {
+        return {op.qubit};
+    }
+    if (op.type == Operation::MULTI_CONTROLLED_GATE) {
+        std::vector<size_t> support = op.controls;
+        support.push_back(op.target);
+        return support;
+    }
+    return {op.control, op.target};
+}
+
+} // namespace
+
+template <typename Scalar>
+void QuantumCircuit::execute_blocked(QuantumStateT<Scalar>& state, const std::vector<Operation>& ops) const {
+    GateBlock block;
+
+    auto flush = [&]() {
+        if (block.ops.empty()) {
+            return;
+        }
+        if (block.ops.size() == 1) {
+            // A lone operation is cheaper through the specialized kernels
+            // than through the generic matrix sweep.
+            apply_operation(state, block.ops.front());
+        } else {
+#ifdef QSIM_PROFILE
+            uint64_t start_cycles = profile_cycles();
+            auto start = std::chrono::steady_clock::now();
+#endif
+            state.apply_block_gate(block.matrix, block.qubits);
+#ifdef QSIM_PROFILE
+            auto end = std::chrono::steady_clock::now();
+            profile_record(
+                "block", profile_cycles() - start_cycles,
+                static_cast<double>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()),
+                state.size(), state.size() * 2 * sizeof(std::complex<Scalar>));
+#endif
+        }
+        block.reset();
+    };
+
+    for (const auto& op : ops) {
+        std::vector<size_t> new_qubits;
+        for (size_t q : operation_support(op)) {
+            if (block.position_of(q) == block.qubits.size()) {
+                new_qubits.push_back(q);
+            }
+        }
+
+        if (block.qubits.size() + new_qubits.size() > kBlockQubits) {
+            flush();
+            new_qubits = operation_support(op);
+        }
+
+        if (block.qubits.empty()) {
+            block.matrix = Eigen::MatrixXcd::Identity(1, 1);
+        }
+        for (size_t q : new_qubits) {
+            block.add_qubit(q);
+        }
+        block.absorb(op);
+    }
+
+    flush();
+}
+
+size_t QuantumCircuit::num_fused_operations() const {
+    std::vector<Operation> ops = fused_operations();
+    size_t count = ops.size();
+    OperationArena::release(std::move(ops));
+    return count;
+}
+
+namespace {
+
+// Fixed-size execution engine for small circuits. At these widths the
+// state lives in L1/L2 and the dynamic kernels are dominated by loop
+// setup, Eigen dynamic-size indirection, and threshold checks rather
+// than memory traffic, so each width gets its own instantiation with
+// compile-time trip counts the compiler can unroll. Same index math as
+// the QuantumStateT kernels, minus the parallel scaffolding - states
+// this small never reach kParallelThresholdQubits anyway.
+template <size_t NumQubits, typename Scalar>
+class FixedStateT {
+public:
+    using Amplitude = std::complex<Scalar>;
+    static constexpr size_t kSize = 1ULL << NumQubits;
+
+    FixedStateT() {
+        amplitudes_.setZero();
+        amplitudes_(0) = Amplitude(1.0, 0.0);
+    }
+
+    void apply(const Operation& op) {
+        switch (op.type) {
+            case Operation::SINGLE_GATE:
+                apply_single(op.gate, op.qubit, op.gate_class);
+                break;
+            case Operation::CONTROLLED_PHASE: {
+                Amplitude factor(op.gate(1, 1));
+                size_t mask = (1ULL << op.control) | (1ULL << op.target);
+                for (size_t i = 0; i < kSize; ++i) {
+                    if ((i & mask) == mask) {
+                        amplitudes_(i) *= factor;
+                    }
+                }
+                break;
+            }
+            case Operation::CONTROLLED_GATE:
+                apply_controlled(op.gate, op.control, op.target);
+                break;
+            case Operation::MULTI_CONTROLLED_GATE:
+                apply_multi_controlled(op.gate, op.controls, op.target);
+                break;
+            case Operation::TWO_QUBIT_GATE:
+                apply_two_qubit(op.two_qubit_gate, op.control, op.target);
+                break;
+        }
+    }
+
+    void copy_into(QuantumStateT<Scalar>& state) const {
+        std::copy(amplitudes_.data(), amplitudes_.data() + kSize, state.data());
+    }
+
+private:
+    void apply_single(const Gate& gate, size_t qubit, GateClass gate_class) {
+        size_t low_mask = (1ULL << qubit) - 1;
+        if (gate_class == GateClass::DIAGONAL) {
+            Amplitude s0(gate(0, 0)), s1(gate(1, 1));
+            for (size_t i = 0; i < kSize; ++i) {
+                amplitudes_(i) *= ((i >> qubit) & 1) ? s1 : s0;
+            }
+            return;
+        }
+        if (gate_class == GateClass::PERMUTATION) {
+            Amplitude s01(gate(0, 1)), s10(gate(1, 0));
+            for (size_t p = 0; p < kSize / 2; ++p) {
+                size_t i = ((p >> qubit) << (qubit + 1)) | (p & low_mask);
+                size_t j = i | (1ULL << qubit);
+                Amplitude amp0 = amplitudes_(i);
+                amplitudes_(i) = s01 * amplitudes_(j);
+                amplitudes_(j) = s10 * amp0;
+            }
+            return;
+        }
+        Amplitude g00(gate(0, 0)), g01(gate(0, 1)), g10(gate(1, 0)), g11(gate(1, 1));
+        for (size_t p = 0; p < kSize / 2; ++p) {
+            size_t i = ((p >> qubit) << (qubit + 1)) | (p & low_mask);
+            size_t j = i | (1ULL << qubit);
+            Amplitude amp0 = amplitudes_(i);
+            Amplitude amp1 = amplitudes_(j);
+            amplitudes_(i) = g00 * amp0 + g01 * amp1;
+            amplitudes_(j) = g10 * amp0 + g11 * amp1;
+        }
+    }
+
+    void apply_controlled(const Gate& gate, size_t control, size_t target) {
+        size_t lo = std::min(control, target);
+        size_t hi = std::max(control, target);
+        size_t control_bit = 1ULL << control;
+        size_t target_bit = 1ULL << target;
+        Amplitude g00(gate(0, 0)), g01(gate(0, 1)), g10(gate(1, 0)), g11(gate(1, 1));
+        for (size_t p = 0; p < kSize / 4; ++p) {
+            size_t base = ((p >> lo) << (lo + 1)) | (p & ((1ULL << lo) - 1));
+            base = ((base >> hi) << (hi + 1)) | (base & ((1ULL << hi) - 1));
+            size_t i = base | control_bit;
+            size_t j = i | target_bit;
+            Amplitude amp0 = amplitudes_(i);
+            Amplitude amp1 = amplitudes_(j);
+            amplitudes_(i) = g00 * amp0 + g01 * amp1;
+            amplitudes_(j) = g10 * amp0 + g11 * amp1;
+        }
+    }
+
+    void apply_two_qubit(const Eigen::Matrix4cd& gate, size_t q0, size_t q1) {
+        Eigen::Matrix<Amplitude, 4, 4> m = gate.cast<Amplitude>();
+        size_t lo = std::min(q0, q1);
+        size_t hi = std::max(q0, q1);
+        size_t bit0 = 1ULL << q0;
+        size_t bit1 = 1ULL << q1;
+        for (size_t p = 0; p < kSize / 4; ++p) {
+            size_t base = ((p >> lo) << (lo + 1)) | (p & ((1ULL << lo) - 1));
+            base = ((base >> hi) << (hi + 1)) | (base & ((1ULL << hi) - 1));
+            size_t i0 = base;
+            size_t i1 = base | bit0;
+            size_t i2 = base | bit1;
+            size_t i3 = base | bit0 | bit1;
+            Amplitude a0 = amplitudes_(i0);
+            Amplitude a1 = amplitudes_(i1);
+            Amplitude a2 = amplitudes_(i2);
+            Amplitude a3 = amplitudes_(i3);
+            amplitudes_(i0) = m(0, 0) * a0 + m(0, 1) * a1 + m(0, 2) * a2 + m(0, 3) * a3;
+            amplitudes_(i1) = m(1, 0) * a0 + m(1, 1) * a1 + m(1, 2) * a2 + m(1, 3) * a3;
+            amplitudes_(i2) = m(2, 0) * a0 + m(2, 1) * a1 + m(2, 2) * a2 + m(2, 3) * a3;
+            amplitudes_(i3) = m(3, 0) * a0 + m(3, 1) * a1 + m(3, 2) * a2 + m(3, 3) * a3;
+        }
+    }
+
+    void apply_multi_controlled(const Gate& gate, const std::vector<size_t>& controls,
+                                size_t target) {
+        std::vector<size_t> positions = controls;
+        positions.push_back(target);
+        std::sort(positions.begin(), positions.end());
+
+        size_t control_mask = 0;
+        for (size_t c : controls) {
+            control_mask |= 1ULL << c;
+        }
+        size_t target_bit = 1ULL << target;
+        size_t num_iters = kSize >> positions.size();
+        Amplitude g00(gate(0, 0)), g01(gate(0, 1)), g10(gate(1, 0)), g11(gate(1, 1));
+        for (size_t p = 0; p < num_iters; ++p) {
+            size_t base = p;
+            for (size_t q : positions) {
+                base = ((base >> q) << (q + 1)) | (base & ((1ULL << q) - 1));
+            }
+            size_t i = base | control_mask;
+            size_t j = i | target_bit;
+            Amplitude amp0 = amplitudes_(i);
+            Amplitude amp1 = amplitudes_(j);
+            amplitudes_(i) = g00 * amp0 + g01 * amp1;
+            amplitudes_(j) = g10 * amp0 + g11 * amp1;
+        }
+    }
+
+    Eigen::Matrix<Amplitude, kSize, 1> amplitudes_;
+};
+
+template <typename Scalar>
+using FixedExecuteFn = void (*)(const std::vector<Operation>&, QuantumStateT<Scalar>&);
+
+template <size_t NumQubits, typename Scalar>
+void execute_fixed(const std::vector<Operation>& ops, QuantumStateT<Scalar>& out) {
+    FixedStateT<NumQubits, Scalar> state;
+    for (const Operation& op : ops) {
+        state.apply(op);
+    }
+    state.copy_into(out);
+}
+
+// Jump table indexed by num_qubits - 1: one indirect call selects the
+// matching instantiation.
+template <typename Scalar, size_t... Is>
+constexpr std::array<FixedExecuteFn<Scalar>, sizeof...(Is)>
+make_fixed_dispatch(std::index_sequence<Is...>) {
+    return {{&execute_fixed<Is + 1, Scalar>...}};
+}
+
+// Stride-critical qubits of an operation: those whose butterfly pairs
+// stride by 1 << position. Control bits only gate which indices are
+// visited and diagonal updates scan linearly, so neither ever justifies
+// a swap.
+void collect_stride_qubits(const Operation& op, std::vector<size_t>& out) {
+    out.clear();
+    switch (op.type) {
+        case Operation::SINGLE_GATE:
+            if (op.gate_class != GateClass::DIAGONAL) {
+                out.push_back(op.qubit);
+            }
+            break;
+        case Operation::CONTROLLED_GATE:
+        case Operation::MULTI_CONTROLLED_GATE:
+            out.push_back(op.target);
+            break;
+        case Operation::TWO_QUBIT_GATE:
+            out.push_back(op.control);
+            out.push_back(op.target);
+            break;
+        case Operation::CONTROLLED_PHASE:
+            break;
+    }
+}
+
+size_t count_stride_uses(const std::vector<Operation>& ops, size_t from, size_t qubit) {
+    size_t uses = 0;
+    std::vector<size_t> critical;
+    size_t end = std::min(ops.size(), from + QuantumCircuit::kRemapWindow);
+    for (size_t k = from; k < end; ++k) {
+        collect_stride_qubits(ops[k], critical);
+        for (size_t q : critical) {
+            if (q == qubit) {
+                ++uses;
+            }
+        }
+    }
+    return uses;
+}
+
+// Rewrites the stream onto physical positions under a logical-to-physical
+// permutation, inserting a SWAP pass whenever the lookahead shows a high
+// qubit worth pulling into a cold low position. Returns the final
+// physical-to-logical map for permute_qubits to fold back out.
+std::vector<size_t> remap_operations(std::vector<Operation>& ops, size_t num_qubits) {
+    std::vector<size_t> perm(num_qubits);      // logical -> physical
+    std::vector<size_t> position(num_qubits);  // physical -> logical
+    for (size_t q = 0; q < num_qubits; ++q) {
+        perm[q] = q;
+        position[q] = q;
+    }
+
+    Eigen::Matrix4cd swap_gate = Eigen::Matrix4cd::Zero();
+    swap_gate(0, 0) = 1;
+    swap_gate(1, 2) = 1;
+    swap_gate(2, 1) = 1;
+    swap_gate(3, 3) = 1;
+
+    std::vector<Operation> out;
+    out.reserve(ops.size() + ops.size() / 8);
+    std::vector<size_t> critical;
+    for (size_t k = 0; k < ops.size(); ++k) {
+        collect_stride_qubits(ops[k], critical);
+        for (size_t q : critical) {
+            size_t high = perm[q];
+            if (high < QuantumCircuit::kRemapHighQubit) {
+                continue;
+            }
+            if (count_stride_uses(ops, k, q) < QuantumCircuit::kRemapMinUses) {
+                continue;
+            }
+            // Victim: the low position whose logical qubit is least used in
+            // the window and not touched by this operation.
+            std::vector<size_t> support = operation_support(ops[k]);
+            size_t best = num_qubits;
+            size_t best_uses = SIZE_MAX;
+            for (size_t low = 0; low < QuantumCircuit::kRemapHighQubit; ++low) {
+                size_t logical = position[low];
+                if (std::find(support.begin(), support.end(), logical) != support.end()) {
+                    continue;
+                }
+                size_t uses = count_stride_uses(ops, k, logical);
+                if (uses < best_uses) {
+                    best_uses = uses;
+                    best = low;
+                }
+                if (uses == 0) {
+                    break;
+                }
+            }
+            if (best == num_qubits) {
+                continue;
+            }
+            out.push_back({Operation::TWO_QUBIT_GATE, Gate(), 0, best, high, {},
+                           swap_gate, GateClass::GENERAL});
+            size_t displaced = position[best];
+            std::swap(position[best], position[high]);
+            perm[q] = best;
+            perm[displaced] = high;
+        }
+
+        Operation op = ops[k];
+        switch (op.type) {
+            case Operation::SINGLE_GATE:
+                op.qubit = perm[op.qubit];
+                break;
+            case Operation::CONTROLLED_GATE:
+            case Operation::CONTROLLED_PHASE:
+            case Operation::TWO_QUBIT_GATE:
+                op.control = perm[op.control];
+                op.target = perm[op.target];
+                break;
+            case Operation::MULTI_CONTROLLED_GATE:
+                for (size_t& c : op.controls) {
+                    c = perm[c];
+                }
+                op.target = perm[op.target];
+                break;
+        }
+        out.push_back(std::move(op));
+    }
+    ops.swap(out);
+    return position;
+}
+
+}  // namespace
+
+template <typename Scalar>
+QuantumStateT<Scalar> QuantumCircuit::execute_impl() const {
+    QuantumStateT<Scalar> state(num_qubits_);
+    auto ops = fused_operations();
+
+    // Small circuits run entirely on the fixed-size engine; verification
+    // mode stays on the dynamic path so the two can be cross-checked.
+    if (!QuantumStateT<Scalar>::verification_mode() && num_qubits_ >= 1 &&
+        num_qubits_ <= kFixedDispatchMaxQubits) {
+        static constexpr auto dispatch = make_fixed_dispatch<Scalar>(
+            std::make_index_sequence<kFixedDispatchMaxQubits>{});
+        dispatch[num_qubits_ - 1](ops, state);
+        OperationArena::release(std::move(ops));
+        return state;
+    }
+
+    // Constant-fold the leading single-qubit gates: acting on |0...0> they
+    // only ever produce a product state, so they initialize the vector
+    // directly instead of costing one full sweep each. Distinct qubits
+    // commute, so ascending order keeps the fill contiguous.
+    if (!QuantumStateT<Scalar>::verification_mode()) {
+        size_t prefix = 0;
+        uint64_t seen = 0;
+        std::vector<ProductFactor> factors;
+        while (prefix < ops.size() && ops[prefix].type == Operation::SINGLE_GATE &&
+               ((seen >> ops[prefix].qubit) & 1) == 0) {
+            const Gate& gate = ops[prefix].gate;
+            factors.push_back({ops[prefix].qubit, gate(0, 0), gate(1, 0)});
+            seen |= 1ULL << ops[prefix].qubit;
+            ++prefix;
+        }
+        if (prefix > 0) {
+            std::sort(factors.begin(), factors.end(),
+                      [](const ProductFactor& a, const ProductFactor& b) {
+                          return a.qubit < b.qubit;
+                      });
+            state.initialize_product(factors);
+            ops.erase(ops.begin(), ops.begin() + prefix);
+        }
+    }
+
+    // Pull repeatedly-used high qubits into low positions before the
+    // sweep-heavy execution; the SWAPs emitted are ordinary two-qubit
+    // operations, so the block scheduler absorbs them like any other.
+    std::vector<size_t> position_map;
+    if (!QuantumStateT<Scalar>::verification_mode() &&
+        num_qubits_ >= kRemapThresholdQubits) {
+        position_map = remap_operations(ops, num_qubits_);
+    }
+
+    if (num_qubits_ >= kBlockScheduleThresholdQubits) {
+        execute_blocked(state, ops);
+    } else {
+        for (const auto& op : ops) {
+            apply_operation(state, op);
+        }
+    }
+
+    if (!position_map.empty()) {
+        state.permute_qubits(position_map);
+    }
+
+    OperationArena::release(std::move(ops));
+    return state;
+}
+
+namespace {
+
+// Batched parameter-sweep engine: B state vectors interleaved
+// amplitude-major (buffer[i * B + b]), so applying one gate to all B
+// states makes the batch dimension a contiguous unit-stride inner loop
+// and the gate decode cost is paid once per sweep instead of once per
+// state. Kernels mirror the QuantumStateT index math.
+template <typename Scalar>
+class BatchedStateT {
+public:
+    using Amplitude = std::complex<Scalar>;
+
+    BatchedStateT(size_t num_qubits, size_t batch)
+        : size_(1ULL << num_qubits),
+          batch_(batch),
+          parallel_(num_qubits >= QuantumStateT<Scalar>::kParallelThresholdQubits),
+          buffer_(size_ * batch, Amplitude(0.0, 0.0)) {
+        for (size_t b = 0; b < batch_; ++b) {
+            buffer_[b] = Amplitude(1.0, 0.0);  // |0...0> in every batch entry
+        }
+    }
+
+    void apply_uniform(const Operation& op) {
+        switch (op.type) {
+            case Operation::SINGLE_GATE:
+                apply_single(op.gate, op.qubit, op.gate_class);
+                break;
+            case Operation::CONTROLLED_PHASE: {
+                Amplitude factor(op.gate(1, 1));
+                size_t mask = (1ULL << op.control) | (1ULL << op.target);
+                #pragma omp parallel for if(parallel_)
+                for (size_t i = 0; i < size_; ++i) {
+                    if ((i & mask) != mask) {
+                        continue;
+                    }
+                    Amplitude* row = buffer_.data() + i * batch_;
+                    for (size_t b = 0; b < batch_; ++b) {
+                        row[b] *= factor;
+                    }
+                }
+                break;
+            }
+            case Operation::CONTROLLED_GATE:
+                apply_controlled(op.gate, op.control, op.target);
+                break;
+            case Operation::MULTI_CONTROLLED_GATE:
+                apply_multi_controlled(op.gate, op.controls, op.target);
+                break;
+            case Operation::TWO_QUBIT_GATE:
+                apply_two_qubit(op.two_qubit_gate, op.control, op.target);
+                break;
+        }
+    }
+
+    // Per-batch-entry 2x2 gates (one rotation angle each): same butterfly,
+    // coefficients indexed by batch position.
+    void apply_rotations(const std::vector<Gate>& gates, size_t qubit) {
+        std::vector<Amplitude> g00(batch_), g01(batch_), g10(batch_), g11(batch_);
+        for (size_t b = 0; b < batch_; ++b) {
+            g00[b] = Amplitude(gates[b](0, 0));
+            g01[b] = Amplitude(gates[b](0, 1));
+            g10[b] = Amplitude(gates[b](1, 0));
+            g11[b] = Amplitude(gates[b](1, 1));
+        }
+        size_t num_pairs = size_ >> 1;
+        size_t low_mask = (1ULL << qubit) - 1;
+        #pragma omp parallel for if(parallel_)
+        for (size_t p = 0; p < num_pairs; ++p) {
+            size_t i = ((p >> qubit) << (qubit + 1)) | (p & low_mask);
+            size_t j = i | (1ULL << qubit);
+            Amplitude* row_i = buffer_.data() + i * batch_;
+            Amplitude* row_j = buffer_.data() + j * batch_;
+            for (size_t b = 0; b < batch_; ++b) {
+                Amplitude amp0 = row_i[b];
+                Amplitude amp1 = row_j[b];
+                row_i[b] = g00[b] * amp0 + g01[b] * amp1;
+                row_j[b] = g10[b] * amp0 + g11[b] * amp1;
+            }
+        }
+    }
+
+    void extract(size_t b, Amplitude* out) const {
+        for (size_t i = 0; i < size_; ++i) {
+            out[i] = buffer_[i * batch_ + b];
+        }
+    }
+
+private:
+    void apply_single(const Gate& gate, size_t qubit, GateClass gate_class) {
+        if (gate_class == GateClass::DIAGONAL) {
+            Amplitude d0(gate(0, 0)), d1(gate(1, 1));
+            #pragma omp parallel for if(parallel_)
+            for (size_t i = 0; i < size_; ++i) {
+                Amplitude factor = ((i >> qubit) & 1) ? d1 : d0;
+                Amplitude* row = buffer_.data() + i * batch_;
+                for (size_t b = 0; b < batch_; ++b) {
+                    row[b] *= factor;
+                }
+            }
+            return;
+        }
+        Amplitude g00(gate(0, 0)), g01(gate(0, 1)), g10(gate(1, 0)), g11(gate(1, 1));
+        size_t num_pairs = size_ >> 1;
+        size_t low_mask = (1ULL << qubit) - 1;
+        #pragma omp parallel for if(parallel_)
+        for (size_t p = 0; p < num_pairs; ++p) {
+            size_t i = ((p >> qubit) << (qubit + 1)) | (p & low_mask);
+            size_t j = i | (1ULL << qubit);
+            Amplitude* row_i = buffer_.data() + i * batch_;
+            Amplitude* row_j = buffer_.data() + j * batch_;
+            for (size_t b = 0; b < batch_; ++b) {
+                Amplitude amp0 = row_i[b];
+                Amplitude amp1 = row_j[b];
+                row_i[b] = g00 * amp0 + g01 * amp1;
+                row_j[b] = g10 * amp0 + g11 * amp1;
+            }
+        }
+    }
+
+    void apply_controlled(const Gate& gate, size_t control, size_t target) {
+        size_t num_iters = size_ >> 2;
+        size_t lo = std::min(control, target);
+        size_t hi = std::max(control, target);
+        size_t control_bit = 1ULL << control;
+        size_t target_bit = 1ULL << target;
+        Amplitude g00(gate(0, 0)), g01(gate(0, 1)), g10(gate(1, 0)), g11(gate(1, 1));
+        #pragma omp parallel for if(parallel_)
+        for (size_t p = 0; p < num_iters; ++p) {
+            size_t base = ((p >> lo) << (lo + 1)) | (p & ((1ULL << lo) - 1));
+            base = ((base >> hi) << (hi + 1)) | (base & ((1ULL << hi) - 1));
+            size_t i = base | control_bit;
+            size_t j = i | target_bit;
+            Amplitude* row_i = buffer_.data() + i * batch_;
+            Amplitude* row_j = buffer_.data() + j * batch_;
+            for (size_t b = 0; b < batch_; ++b) {
+                Amplitude amp0 = row_i[b];
+                Amplitude amp1 = row_j[b];
+                row_i[b] = g00 * amp0 + g01 * amp1;
+                row_j[b] = g10 * amp0 + g11 * amp1;
+            }
+        }
+    }
+
+    void apply_multi_controlled(const Gate& gate, const std::vector<size_t>& controls,
+                                size_t target) {
+        std::vector<size_t> positions = controls;
+        positions.push_back(target);
+        std::sort(positions.begin(), positions.end());
+        size_t control_mask = 0;
+        for (size_t c : controls) {
+            control_mask |= 1ULL << c;
+        }
+        size_t target_bit = 1ULL << target;
+        size_t num_iters = size_ >> positions.size();
+        Amplitude g00(gate(0, 0)), g01(gate(0, 1)), g10(gate(1, 0)), g11(gate(1, 1));
+        #pragma omp parallel for if(parallel_)
+        for (size_t p = 0; p < num_iters; ++p) {
+            size_t base = p;
+            for (size_t q : positions) {
+                base = ((base >> q) << (q + 1)) | (base & ((1ULL << q) - 1));
+            }
+            size_t i = base | control_mask;
+            size_t j = i | target_bit;
+            Amplitude* row_i = buffer_.data() + i * batch_;
+            Amplitude* row_j = buffer_.data() + j * batch_;
+            for (size_t b = 0; b < batch_; ++b) {
+                Amplitude amp0 = row_i[b];
+                Amplitude amp1 = row_j[b];
+                row_i[b] = g00 * amp0 + g01 * amp1;
+                row_j[b] = g10 * amp0 + g11 * amp1;
+            }
+        }
+    }
+
+    void apply_two_qubit(const Eigen::Matrix4cd& gate, size_t q0, size_t q1) {
+        Eigen::Matrix<Amplitude, 4, 4> m = gate.cast<Amplitude>();
+        size_t num_groups = size_ >> 2;
+        size_t lo = std::min(q0, q1);
+        size_t hi = std::max(q0, q1);
+        size_t bit0 = 1ULL << q0;
+        size_t bit1 = 1ULL << q1;
+        #pragma omp parallel for if(parallel_)
+        for (size_t p = 0; p < num_groups; ++p) {
+            size_t base = ((p >> lo) << (lo + 1)) | (p & ((1ULL << lo) - 1));
+            base = ((base >> hi) << (hi + 1)) | (base & ((1ULL << hi) - 1));
+            Amplitude* r0 = buffer_.data() + base * batch_;
+            Amplitude* r1 = buffer_.data() + (base | bit0) * batch_;
+            Amplitude* r2 = buffer_.data() + (base | bit1) * batch_;
+            Amplitude* r3 = buffer_.data() + (base | bit0 | bit1) * batch_;
+            for (size_t b = 0; b < batch_; ++b) {
+                Amplitude a0 = r0[b];
+                Amplitude a1 = r1[b];
+                Amplitude a2 = r2[b];
+                Amplitude a3 = r3[b];
+                r0[b] = m(0, 0) * a0 + m(0, 1) * a1 + m(0, 2) * a2 + m(0, 3) * a3;
+                r1[b] = m(1, 0) * a0 + m(1, 1) * a1 + m(1, 2) * a2 + m(1, 3) * a3;
+                r2[b] = m(2, 0) * a0 + m(2, 1) * a1 + m(2, 2) * a2 + m(2, 3) * a3;
+                r3[b] = m(3, 0) * a0 + m(3, 1) * a1 + m(3, 2) * a2 + m(3, 3) * a3;
+            }
+        }
+    }
+
+    size_t size_;
+    size_t batch_;
+    bool parallel_;
+    std::vector<Amplitude> buffer_;
+};
+
+}  // namespace
+
+size_t QuantumCircuit::num_parameters() const {
+    size_t count = 0;
+    for (const Operation& op : operations_) {
+        if (op.rotation != Operation::Rotation::NONE) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+std::vector<QuantumState> QuantumCircuit::execute_batch(
+    const std::vector<ParameterSet>& parameter_sets) const {
+    size_t expected = num_parameters();
+    for (const ParameterSet& set : parameter_sets) {
+        if (set.size() != expected) {
+            throw std::runtime_error("Parameter set size does not match circuit parameter count");
+        }
+    }
+    size_t batch = parameter_sets.size();
+    if (batch == 0) {
+        return {};
+    }
+
+    // Walks the raw operation list, not the fused one: fusion would bake
+    // the construction-time angles into the fused products.
+    BatchedStateT<double> batched(num_qubits_, batch);
+    std::vector<Gate> gates(batch);
+    size_t param = 0;
+    for (const Operation& op : operations_) {
+        if (op.type == Operation::SINGLE_GATE && op.rotation != Operation::Rotation::NONE) {
+            for (size_t b = 0; b < batch; ++b) {
+                double theta = parameter_sets[b][param];
+                switch (op.rotation) {
+                    case Operation::Rotation::RX: gates[b] = Gates::rx(theta); break;
+                    case Operation::Rotation::RY: gates[b] = Gates::ry(theta); break;
+                    default: gates[b] = Gates::rz(theta); break;
+                }
+            }
+            ++param;
+            batched.apply_rotations(gates, op.qubit);
+        } else {
+            batched.apply_uniform(op);
+        }
+    }
+
+    std::vector<QuantumState> states;
+    states.reserve(batch);
+    for (size_t b = 0; b < batch; ++b) {
+        states.emplace_back(num_qubits_);
+        batched.extract(b, states.back().data());
+    }
+    return states;
+}
+
+// Stochastic trajectory engine for execute_trajectories.
+namespace {
+
+// Counter-based RNG: the splitmix64 finalizer over a counter mixed with a
+// key derived from (seed, trajectory index). Each draw is a pure function
+// of those values, so trajectories share no mutable state across threads
+// and a rerun with the same seed replays the same jumps.
+struct TrajectoryRng {
+    uint64_t key;
+    uint64_t counter = 0;
+
+    TrajectoryRng(uint64_t seed, uint64_t trajectory)
+        : key(seed ^ ((trajectory + 1) * 0x9E3779B97F4A7C15ULL)) {}
+
+    // Uniform in [0, 1).
+    double next() {
+        uint64_t z = key + ++counter * 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z ^= z >> 31;
+        return static_cast<double>(z >> 11) * 0x1.0p-53;
+    }
+};
+
+// Qubits an operation acts on; every one of them is a noise site.
+void noise_support(const Operation& op, std::vector<size_t>& qubits) {
+    qubits.clear();
+    switch (op.type) {
+        case Operation::SINGLE_GATE:
+            qubits.push_back(op.qubit);
+            break;
+        case Operation::CONTROLLED_GATE:
+        case Operation::CONTROLLED_PHASE:
+        case Operation::TWO_QUBIT_GATE:
+            qubits.push_back(op.control);
+            qubits.push_back(op.target);
+            break;
+        case Operation::MULTI_CONTROLLED_GATE:
+            qubits = op.controls;
+            qubits.push_back(op.target);
+            break;
+    }
+}
+
+// Depolarizing channel as a trajectory event: with probability p apply a
+// uniformly random Pauli. The same draw selects both the event and which
+// Pauli, so a site costs a single RNG call.
+void apply_depolarizing(QuantumState& state, size_t qubit, double p, TrajectoryRng& rng) {
+    double r = rng.next();
+    if (r >= p) {
+        return;
+    }
+    int which = static_cast<int>(r / p * 3.0);
+    switch (which) {
+        case 0: state.apply_single_gate(Gates::pauli_x(), qubit); break;
+        case 1: state.apply_single_gate(Gates::pauli_y(), qubit); break;
+        default: state.apply_single_gate(Gates::pauli_z(), qubit); break;
+    }
+}
+
+// Amplitude damping as a quantum jump: the decay branch (Kraus operator
+// [[0, sqrt(g)], [0, 0]]) fires with probability gamma * P(|1>), otherwise
+// the no-jump branch diag(1, sqrt(1-gamma)) applies; either branch is
+// renormalized so the trajectory stays a pure state. P(|1>) depends on the
+// current state, so each site costs one extra sweep. The loops stay serial:
+// they run inside the trajectory-parallel region, which already owns every
+// core.
+void apply_amplitude_damping(QuantumState& state, size_t qubit, double gamma,
+                             TrajectoryRng& rng) {
+    Complex* amps = state.data();
+    size_t half = state.size() >> 1;
+    size_t bit = 1ULL << qubit;
+    size_t low_mask = bit - 1;
+
+    double prob_one = 0.0;
+    for (size_t p = 0; p < half; ++p) {
+        size_t i1 = (((p >> qubit) << (qubit + 1)) | (p & low_mask)) | bit;
+        prob_one += std::norm(amps[i1]);
+    }
+
+    double p_jump = gamma * prob_one;
+    if (rng.next() < p_jump) {
+        // K1 maps amp1 to sqrt(gamma)*amp1 on the |0> side; dividing by
+        // sqrt(p_jump) leaves 1/sqrt(P(|1>)).
+        double scale = 1.0 / std::sqrt(prob_one);
+        for (size_t p = 0; p < half; ++p) {
+            size_t i0 = ((p >> qubit) << (qubit + 1)) | (p & low_mask);
+            amps[i0] = amps[i0 | bit] * scale;
+            amps[i0 | bit] = Complex(0.0, 0.0);
+        }
+    } else {
+        double renorm = 1.0 / std::sqrt(1.0 - p_jump);
+        double decay = std::sqrt(1.0 - gamma) * renorm;
+        for (size_t p = 0; p < half; ++p) {
+            size_t i0 = ((p >> qubit) << (qubit + 1)) | (p & low_mask);
+            amps[i0] *= renorm;
+            amps[i0 | bit] *= decay;
+        }
+    }
+}
+
+} // namespace
+
+QuantumCircuit& QuantumCircuit::with_noise(const NoiseModel& model) {
+    noise_ = model;
+    has_noise_ = true;
+    return *this;
+}
+
+std::vector<double> QuantumCircuit::execute_trajectories(size_t num_trajectories,
+                                                         uint64_t seed) const {
+    size_t size = 1ULL << num_qubits_;
+    std::vector<double> averaged(size, 0.0);
+    if (num_trajectories == 0) {
+        return averaged;
+    }
+
+    // Walks the raw operation list, not the fused one: noise attaches per
+    // built gate, and fusion would merge away noise sites. Trajectories
+    // are independent, so they parallelize across threads; each worker
+    // keeps reusing the one pooled state buffer its QuantumState acquires.
+    #pragma omp parallel
+    {
+        std::vector<double> local(size, 0.0);
+        std::vector<double> probs(size);
+        std::vector<size_t> support;
+
+        #pragma omp for schedule(dynamic)
+        for (size_t t = 0; t < num_trajectories; ++t) {
+            QuantumState state(num_qubits_);
+            TrajectoryRng rng(seed, t);
+            for (const Operation& op : operations_) {
+                apply_operation(state, op);
+                if (has_noise_) {
+                    noise_support(op, support);
+                    for (size_t q : support) {
+                        if (noise_.depolarizing > 0.0) {
+                            apply_depolarizing(state, q, noise_.depolarizing, rng);
+                        }
+                        if (noise_.amplitude_damping > 0.0) {
+                            apply_amplitude_damping(state, q, noise_.amplitude_damping, rng);
+                        }
+                    }
+                }
+            }
+            state.probabilities_into(probs.data(), size);
+            for (size_t i = 0; i < size; ++i) {
+                local[i] += probs[i];
+            }
+        }
+
+        #pragma omp critical
+        {
+            for (size_t i = 0; i < size; ++i) {
+                averaged[i] += local[i];
+            }
+        }
+    }
+
+    double weight = 1.0 / static_cast<double>(num_trajectories);
+    for (double& p : averaged) {
+        p *= weight;
+    }
+    return averaged;
+}
+
+QuantumState QuantumCircuit::execute() const {
+    return execute_impl<double>();
+}
+
+QuantumStateF QuantumCircuit::execute_single_precision() const {
+    return execute_impl<float>();
+}
+
+// QasmLoader implementation
+namespace {
+
+// Evaluates the angle subset QASM circuits in this repo use:
+// [-][n*]pi[/d] or a plain numeric literal, e.g. "pi/8", "3*pi/4", "0.25".
+double eval_qasm_angle(const std::string& raw) {
+    std::string expr;
+    for (char c : raw) {
+        if (!std::isspace(static_cast<unsigned char>(c))) {
+            expr += c;
+        }
+    }
+    if (expr.empty()) {
+        throw std::runtime_error("qasm: empty angle expression");
+    }
+
+    size_t pos = 0;
+    double sign = 1.0;
+    if (expr[0] == '-') {
+        sign = -1.0;
+        pos = 1;
+    }
+
+    double value = 1.0;
+    char op = '*';
+    while (pos < expr.size()) {
+        size_t end = pos;
+        while (end < expr.size() && expr[end] != '*' && expr[end] != '/') {
+            ++end;
+        }
+        std::string token = expr.substr(pos, end - pos);
+        double factor;
+        if (token == "pi") {
+            factor = M_PI;
+        } else {
+            try {
+                factor = std::stod(token);
+            } catch (const std::exception&) {
+                throw std::runtime_error("qasm: bad angle token '" + token + "'");
+            }
+        }
+        value = op == '*' ? value * factor : value / factor;
+        if (end < expr.size()) {
+            op = expr[end];
+        }
+        pos = end + 1;
+    }
+    return sign * value;
+}
+
+// Extracts the index from an operand like "q[3]".
+size_t parse_qasm_operand(const std::string& operand, const std::string& qreg,
+                          size_t num_qubits) {
+    size_t open = operand.find('[');
+    size_t close = operand.find(']');
+    if (open == std::string::npos || close == std::string::npos || close < open ||
+        operand.substr(0, open) != qreg) {
+        throw std::runtime_error("qasm: bad operand '" + operand + "'");
+    }
+    size_t index = std::stoul(operand.substr(open + 1, close - open - 1));
+    if (index >= num_qubits) {
+        throw std::runtime_error("qasm: qubit index out of range in '" + operand + "'");
+    }
+    return index;
+}
+
+} // namespace
+
+QuantumCircuit QasmLoader::parse(const std::string& source) {
+    // Normalize: strip line comments, then split on ';'.
+    std::string cleaned;
+    std::istringstream lines(source);
+    std::string line;
+    while (std::getline(lines, line)) {
+        size_t comment = line.find("//");
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        cleaned += line;
+        cleaned += '\n';
+    }
+
+    std::string qreg_name;
+    size_t num_qubits = 0;
+    std::vector<QuantumCircuit> circuit;  // 0 or 1; no default constructor
+
+    std::istringstream statements(cleaned);
+    std::string statement;
+    while (std::getline(statements, statement, ';')) {
+        std::istringstream tokens(statement);
+        std::string head;
+        tokens >> head;
+        if (head.empty() || head == "OPENQASM" || head == "include" ||
+            head == "creg" || head == "barrier" || head == "measure") {
+            continue;
+        }
+
+        if (head == "qreg") {
+            if (!circuit.empty()) {
+                throw std::runtime_error("qasm: only a single qreg is supported");
+            }
+            std::string decl;
+            tokens >> decl;
+            size_t open = decl.find('[');
+            size_t close = decl.find(']');
+            if (open == std::string::npos || close == std::string::npos) {
+                throw std::runtime_error("qasm: bad qreg declaration '" + decl + "'");
+            }
+            qreg_name = decl.substr(0, open);
+            num_qubits = std::stoul(decl.substr(open + 1, close - open - 1));
+            circuit.emplace_back(num_qubits);
+            continue;
+        }
+
+        if (circuit.empty()) {
+            throw std::runtime_error("qasm: gate before qreg declaration");
+        }
+
+        // Gate name with optional parenthesized angle.
+        std::string name = head;
+        std::string angle_text;
+        size_t paren = statement.find('(');
+        if (paren != std::string::npos) {
+            size_t close = statement.find(')', paren);
+            if (close == std::string::npos) {
+                throw std::runtime_error("qasm: unterminated angle in '" + statement + "'");
+            }
+            angle_text = statement.substr(paren + 1, close - paren - 1);
+            size_t name_start = statement.find_first_not_of(" \t\n");
+            name = statement.substr(name_start, paren - name_start);
+        }
+
+        // Remaining operands, comma separated.
+        std::string rest = paren != std::string::npos
+                               ? statement.substr(statement.find(')', paren) + 1)
+                               : statement.substr(statement.find(head) + head.size());
+        std::vector<size_t> qubits;
+        std::istringstream operands(rest);
+        std::string operand;
+        while (std::getline(operands, operand, ',')) {
+            std::string trimmed;
+            for (char c : operand) {
+                if (!std::isspace(static_cast<unsigned char>(c))) {
+                    trimmed += c;
+                }
+            }
+            if (!trimmed.empty()) {
+                qubits.push_back(parse_qasm_operand(trimmed, qreg_name, num_qubits));
+            }
+        }
+
+        QuantumCircuit& target = circuit.front();
+        if (name == "h" && qubits.size() == 1) {
+            target.h(qubits[0]);
+        } else if (name == "x" && qubits.size() == 1) {
+            target.x(qubits[0]);
+        } else if (name == "y" && qubits.size() == 1) {
+            target.y(qubits[0]);
+        } else if (name == "z" && qubits.size() == 1) {
+            target.z(qubits[0]);
+        } else if (name == "rx" && qubits.size() == 1) {
+            target.rx(qubits[0], eval_qasm_angle(angle_text));
+        } else if (name == "ry" && qubits.size() == 1) {
+            target.ry(qubits[0], eval_qasm_angle(angle_text));
+        } else if (name == "rz" && qubits.size() == 1) {
+            target.rz(qubits[0], eval_qasm_angle(angle_text));
+        } else if (name == "cx" && qubits.size() == 2) {
+            target.cnot(qubits[0], qubits[1]);
+        } else if ((name == "cp" || name == "cu1") && qubits.size() == 2) {
+            target.cp(qubits[0], qubits[1], eval_qasm_angle(angle_text));
+        } else if (name == "ccx" && qubits.size() == 3) {
+            target.ccx(qubits[0], qubits[1], qubits[2]);
+        } else {
+            throw std::runtime_error("qasm: unsupported statement '" + statement + "'");
+        }
+    }
+
+    if (circuit.empty()) {
+        throw std::runtime_error("qasm: no qreg declaration found");
+    }
+    return circuit.front();
+}
+
+QuantumCircuit QasmLoader::load_file(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("qasm: cannot open '" + path + "'");
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    return parse(buffer.str());
+}
+
+// MemoryTelemetry implementation
+namespace {
+
+std::atomic<size_t> heap_live_bytes{0};
+std::atomic<size_t> heap_total_bytes{0};
+
+void heap_note_alloc(size_t bytes) {
+    heap_live_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    heap_total_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void heap_note_free(size_t bytes) {
+    heap_live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+// Resident set in bytes, read via raw syscalls so the sampler thread does
+// not itself allocate.
+size_t read_rss_bytes() {
+#ifdef __linux__
+    int fd = open("/proc/self/statm", O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    char buf[128];
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) {
+        return 0;
+    }
+    buf[n] = '\0';
+    // second field: resident pages
+    char* cursor = buf;
+    while (*cursor != ' ' && *cursor != '\0') {
+        ++cursor;
+    }
+    size_t pages = strtoull(cursor, nullptr, 10);
+    return pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+struct TelemetryWindow {
+    std::thread sampler;
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> max_rss{0};
+    std::atomic<size_t> max_heap{0};
+    size_t start_total = 0;
+};
+
+thread_local std::unique_ptr<TelemetryWindow> telemetry_window;
+
+} // namespace
+
+void MemoryTelemetry::record_allocation(size_t bytes) {
+    heap_note_alloc(bytes);
+}
+
+void MemoryTelemetry::record_release(size_t bytes) {
+    heap_note_free(bytes);
+}
+
+void MemoryTelemetry::begin() {
+    auto window = std::make_unique<TelemetryWindow>();
+    window->start_total = heap_total_bytes.load(std::memory_order_relaxed);
+    window->max_rss = read_rss_bytes();
+    window->max_heap = heap_live_bytes.load(std::memory_order_relaxed);
+
+    TelemetryWindow* raw = window.get();
+    window->sampler = std::thread([raw]() {
+        while (!raw->stop.load(std::memory_order_relaxed)) {
+            size_t rss = read_rss_bytes();
+            if (rss > raw->max_rss.load(std::memory_order_relaxed)) {
+                raw->max_rss.store(rss, std::memory_order_relaxed);
+            }
+            size_t heap = heap_live_bytes.load(std::memory_order_relaxed);
+            if (heap > raw->max_heap.load(std::memory_order_relaxed)) {
+                raw->max_heap.store(heap, std::memory_order_relaxed);
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    });
+    telemetry_window = std::move(window);
+}
+
+MemoryStats MemoryTelemetry::end() {
+    MemoryStats stats = {0.0, 0.0, 0.0};
+    if (!telemetry_window) {
+        return stats;
+    }
+    TelemetryWindow& window = *telemetry_window;
+    window.stop = true;
+    window.sampler.join();
+
+    constexpr double kMiB = 1024.0 * 1024.0;
+    size_t final_rss = read_rss_bytes();
+    stats.peak_rss_mb = std::max(window.max_rss.load(), final_rss) / kMiB;
+    stats.peak_heap_mb =
+        std::max(window.max_heap.load(), heap_live_bytes.load(std::memory_order_relaxed)) / kMiB;
+    stats.allocated_mb =
+        (heap_total_bytes.load(std::memory_order_relaxed) - window.start_total) / kMiB;
+    telemetry_window.reset();
+    return stats;
+}
+
+#ifdef __linux__
+
+// Global new/delete replacements feeding the heap counters. Sized by
+// malloc_usable_size so allocations and frees always balance, whichever
+// delete form the call site uses.
+void* operator new(std::size_t size) {
+    void* ptr = std::malloc(size ? size : 1);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    heap_note_alloc(malloc_usable_size(ptr));
+    return ptr;
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    size_t alignment = static_cast<size_t>(align);
+    void* ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    heap_note_alloc(malloc_usable_size(ptr));
+    return ptr;
+}
+
+void* operator new[](std::size_t size, std::align_val_t align) {
+    return ::operator new(size, align);
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr != nullptr) {
+        heap_note_free(malloc_usable_size(ptr));
+        std::free(ptr);
+    }
+}
+
+void operator delete[](void* ptr) noexcept {
+    ::operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    ::operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    ::operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    ::operator delete(ptr);
 }
 
-Gate Gates::rx(double theta) {
-    double cos_half = std::cos(theta / 2.0);
-    double sin_half = std::sin(theta / 2.0);
-    
-    Gate gate;
-    gate << cos_half, Complex(0, -sin_half),
-            Complex(0, -sin_half), cos_half;
-    return gate;
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    ::operator delete(ptr);
 }
 
-Gate Gates::ry(double theta) {
-    double cos_half = std::cos(theta / 2.0);
-    double sin_half = std::sin(theta / 2.0);
-    
-    Gate gate;
-    gate << cos_half, -sin_half,
-            sin_half, cos_half;
-    return gate;
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    ::operator delete(ptr);
 }
 
-Gate Gates::rz(double theta) {
-    Complex exp_neg = std::exp(Complex(0, -theta / 2.0));
-    Complex exp_pos = std::exp(Complex(0, theta / 2.0));
-    
-    Gate gate;
-    gate << exp_neg, 0,
-            0, exp_pos;
-    return gate;
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+    ::operator delete(ptr);
 }
 
-// QuantumCircuit implementation
-QuantumCircuit::QuantumCircuit(size_t num_qubits) : num_qubits_(num_qubits) {}
+#endif // __linux__
 
-QuantumCircuit& QuantumCircuit::h(size_t qubit) {
-    operations_.push_back({Operation::SINGLE_GATE, Gates::hadamard(), qubit, 0, 0});
-    return *this;
-}
+// BenchmarkRunner implementation
+size_t BenchmarkRunner::repetitions_ = 5;
+size_t BenchmarkRunner::warmup_ = 1;
+BenchmarkRunner::Precision BenchmarkRunner::precision_ = BenchmarkRunner::Precision::DOUBLE;
 
-QuantumCircuit& QuantumCircuit::x(size_t qubit) {
-    operations_.push_back({Operation::SINGLE_GATE, Gates::pauli_x(), qubit, 0, 0});
-    return *this;
+void BenchmarkRunner::set_precision(Precision precision) {
+    precision_ = precision;
 }
 
-QuantumCircuit& QuantumCircuit::y(size_t qubit) {
-    operations_.push_back({Operation::SINGLE_GATE, Gates::pauli_y(), qubit, 0, 0});
-    return *this;
+BenchmarkRunner::Precision BenchmarkRunner::precision() {
+    return precision_;
 }
 
-QuantumCircuit& QuantumCircuit::z(size_t qubit) {
-    operations_.push_back({Operation::SINGLE_GATE, Gates::pauli_z(), qubit, 0, 0});
-    return *this;
+const char* BenchmarkRunner::precision_name() {
+    return precision_ == Precision::SINGLE ? "single" : "double";
 }
 
-QuantumCircuit& QuantumCircuit::rx(size_t qubit, double theta) {
-    operations_.push_back({Operation::SINGLE_GATE, Gates::rx(theta), qubit, 0, 0});
-    return *this;
+void BenchmarkRunner::execute_for_benchmark(const QuantumCircuit& circuit) {
+    if (precision_ == Precision::SINGLE) {
+        auto final_state = circuit.execute_single_precision();
+    } else {
+        auto final_state = circuit.execute();
+    }
 }
 
-QuantumCircuit& QuantumCircuit::ry(size_t qubit, double theta) {
-    operations_.push_back({Operation::SINGLE_GATE, Gates::ry(theta), qubit, 0, 0});
-    return *this;
+void BenchmarkRunner::set_repetitions(size_t repetitions) {
+    repetitions_ = repetitions > 0 ? repetitions : 1;
 }
 
-QuantumCircuit& QuantumCircuit::rz(size_t qubit, double theta) {
-    operations_.push_back({Operation::SINGLE_GATE, Gates::rz(theta), qubit, 0, 0});
-    return *this;
+void BenchmarkRunner::set_warmup(size_t warmup) {
+    warmup_ = warmup;
 }
 
-QuantumCircuit& QuantumCircuit::cnot(size_t control, size_t target) {
-    operations_.push_back({Operation::CONTROLLED_GATE, Gates::pauli_x(), 0, control, target});
-    return *this;
+size_t BenchmarkRunner::num_threads() {
+#ifdef _OPENMP
+    return static_cast<size_t>(omp_get_max_threads());
+#else
+    return 1;
+#endif
 }
 
-QuantumState QuantumCircuit::execute() const {
-    QuantumState state(num_qubits_);
-    
-    for (const auto& op : operations_) {
-        if (op.type == Operation::SINGLE_GATE) {
-            state.apply_single_gate(op.gate, op.qubit);
-        } else {
-            state.apply_controlled_gate(op.gate, op.control, op.target);
-        }
+TimingStats BenchmarkRunner::time_repetitions(const std::function<void()>& body) {
+    for (size_t i = 0; i < warmup_; ++i) {
+        body();
     }
-    
-    return state;
+
+    std::vector<double> samples(repetitions_);
+    for (size_t i = 0; i < repetitions_; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        body();
+        auto end = std::chrono::high_resolution_clock::now();
+        samples[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1e6;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+
+    double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+    double variance = 0.0;
+    for (double sample : samples) {
+        variance += (sample - mean) * (sample - mean);
+    }
+    variance /= n;
+
+    TimingStats stats;
+    stats.min_ms = samples.front();
+    stats.median_ms = n % 2 == 1 ? samples[n / 2]
+                                 : (samples[n / 2 - 1] + samples[n / 2]) / 2.0;
+    stats.p95_ms = samples[(n * 95 + 99) / 100 - 1];
+    stats.stddev_ms = std::sqrt(variance);
+    return stats;
 }
 
-// BenchmarkRunner implementation
 double BenchmarkRunner::get_memory_usage() {
     std::ifstream file("/proc/self/status");
     std::string line;
@@ -197,47 +3120,161 @@ double BenchmarkRunner::get_memory_usage() {
 
 BenchmarkResult BenchmarkRunner::benchmark_ghz_state(size_t num_qubits) {
     double start_memory = get_memory_usage();
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
+    MemoryTelemetry::begin();
+
+    auto build_start = std::chrono::high_resolution_clock::now();
     QuantumCircuit circuit(num_qubits);
     circuit.h(0);
     for (size_t i = 1; i < num_qubits; ++i) {
         circuit.cnot(0, i);
     }
-    
-    auto final_state = circuit.execute();
-    
-    auto end_time = std::chrono::high_resolution_clock::now();
+    auto build_end = std::chrono::high_resolution_clock::now();
+    double construction_ms =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(build_end - build_start).count() / 1e6;
+
+    TimingStats stats = time_repetitions([&]() {
+        execute_for_benchmark(circuit);
+    });
+
     double end_memory = get_memory_usage();
-    
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-    
+    MemoryStats memory = MemoryTelemetry::end();
+
     return {
         "GHZ-" + std::to_string(num_qubits),
         num_qubits,
         num_qubits,
-        duration.count() / 1000.0,
+        stats.median_ms,
         end_memory - start_memory,
-        2
+        memory,
+        2,
+        num_threads(),
+        circuit.num_fused_operations(),
+        construction_ms,
+        stats,
+        repetitions_,
+        precision_name(),
+        0
     };
 }
 
-BenchmarkResult BenchmarkRunner::benchmark_random_circuit(size_t num_qubits, size_t num_gates) {
+BenchmarkResult BenchmarkRunner::benchmark_sparse_ghz(size_t num_qubits) {
     double start_memory = get_memory_usage();
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
+    MemoryTelemetry::begin();
+
+    auto build_start = std::chrono::high_resolution_clock::now();
+    QuantumCircuit circuit(num_qubits);
+    circuit.h(0);
+    for (size_t i = 1; i < num_qubits; ++i) {
+        circuit.cnot(0, i);
+    }
+    auto build_end = std::chrono::high_resolution_clock::now();
+    double construction_ms =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(build_end - build_start).count() / 1e6;
+
+    TimingStats stats = time_repetitions([&]() {
+        std::vector<Operation> ops = circuit.fused_operations();
+        if (precision_ == Precision::SINGLE) {
+            SparseQuantumStateT<float> state(num_qubits);
+            state.apply(ops);
+        } else {
+            SparseQuantumState state(num_qubits);
+            state.apply(ops);
+        }
+        OperationArena::release(std::move(ops));
+    });
+
+    double end_memory = get_memory_usage();
+    MemoryStats memory = MemoryTelemetry::end();
+
+    return {
+        "SparseGHZ-" + std::to_string(num_qubits),
+        num_qubits,
+        num_qubits,
+        stats.median_ms,
+        end_memory - start_memory,
+        memory,
+        2,
+        num_threads(),
+        circuit.num_fused_operations(),
+        construction_ms,
+        stats,
+        repetitions_,
+        precision_name(),
+        0
+    };
+}
+
+BenchmarkResult BenchmarkRunner::benchmark_vqe_batch(size_t num_qubits, size_t num_layers,
+                                                     size_t batch_size) {
+    double start_memory = get_memory_usage();
+    MemoryTelemetry::begin();
+
+    auto build_start = std::chrono::high_resolution_clock::now();
+    QuantumCircuit circuit(num_qubits);
+    for (size_t layer = 0; layer < num_layers; ++layer) {
+        for (size_t q = 0; q < num_qubits; ++q) {
+            circuit.ry(q, 0.0);  // placeholders; execute_batch rebinds them
+            circuit.rz(q, 0.0);
+        }
+        for (size_t q = 0; q + 1 < num_qubits; ++q) {
+            circuit.cnot(q, q + 1);
+        }
+    }
+
+    std::mt19937 gen(42);  // fixed sweep so every run times the same batch
+    std::uniform_real_distribution<> angle_dist(0.0, 2.0 * PI);
+    std::vector<ParameterSet> parameter_sets(batch_size,
+                                             ParameterSet(circuit.num_parameters()));
+    for (auto& set : parameter_sets) {
+        for (double& angle : set) {
+            angle = angle_dist(gen);
+        }
+    }
+    auto build_end = std::chrono::high_resolution_clock::now();
+    double construction_ms =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(build_end - build_start).count() / 1e6;
+
+    TimingStats stats = time_repetitions([&]() {
+        auto states = circuit.execute_batch(parameter_sets);
+    });
+
+    double end_memory = get_memory_usage();
+    MemoryStats memory = MemoryTelemetry::end();
+
+    return {
+        "VQEBatch-" + std::to_string(num_qubits) + "x" + std::to_string(batch_size),
+        num_qubits,
+        circuit.num_operations() * batch_size,
+        stats.median_ms,
+        end_memory - start_memory,
+        memory,
+        num_layers * 3,
+        num_threads(),
+        circuit.num_fused_operations(),
+        construction_ms,
+        stats,
+        repetitions_,
+        precision_name(),
+        42
+    };
+}
+
+namespace {
+
+// Deterministic generator behind benchmark_random_circuit: the same triple
+// always yields the same gate sequence.
+QuantumCircuit generate_random_circuit(size_t num_qubits, size_t num_gates, uint64_t seed) {
     QuantumCircuit circuit(num_qubits);
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937 gen(static_cast<std::mt19937::result_type>(seed));
     std::uniform_int_distribution<> gate_dist(0, 5);
     std::uniform_int_distribution<> qubit_dist(0, num_qubits - 1);
     std::uniform_real_distribution<> angle_dist(0.0, 2.0 * PI);
-    
+
     for (size_t i = 0; i < num_gates; ++i) {
         int gate_type = gate_dist(gen);
         size_t qubit = qubit_dist(gen);
         double angle = angle_dist(gen);
-        
+
         switch (gate_type) {
             case 0: circuit.h(qubit); break;
             case 1: circuit.x(qubit); break;
@@ -248,7 +3285,7 @@ BenchmarkResult BenchmarkRunner::benchmark_random_circuit(size_t num_qubits, siz
             default: circuit.rz(qubit, angle); break;
         }
     }
-    
+
     size_t num_cnots = num_gates / 4;
     for (size_t i = 0; i < num_cnots; ++i) {
         size_t control = qubit_dist(gen);
@@ -258,55 +3295,492 @@ BenchmarkResult BenchmarkRunner::benchmark_random_circuit(size_t num_qubits, siz
         }
         circuit.cnot(control, target);
     }
-    
-    auto final_state = circuit.execute();
-    
-    auto end_time = std::chrono::high_resolution_clock::now();
+    return circuit;
+}
+
+std::mutex random_circuit_cache_mutex;
+std::map<std::tuple<uint64_t, size_t, size_t>, QuantumCircuit> random_circuit_cache;
+
+} // namespace
+
+BenchmarkResult BenchmarkRunner::benchmark_random_circuit(size_t num_qubits, size_t num_gates,
+                                                          uint64_t seed) {
+    double start_memory = get_memory_usage();
+    MemoryTelemetry::begin();
+
+    // Cache hit skips regeneration, so reruns time only execution.
+    auto build_start = std::chrono::high_resolution_clock::now();
+    std::vector<QuantumCircuit> cached;
+    {
+        std::lock_guard<std::mutex> lock(random_circuit_cache_mutex);
+        auto key = std::make_tuple(seed, num_qubits, num_gates);
+        auto it = random_circuit_cache.find(key);
+        if (it == random_circuit_cache.end()) {
+            it = random_circuit_cache
+                     .emplace(key, generate_random_circuit(num_qubits, num_gates, seed))
+                     .first;
+        }
+        cached.push_back(it->second);
+    }
+    QuantumCircuit& circuit = cached.front();
+    auto build_end = std::chrono::high_resolution_clock::now();
+    double construction_ms =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(build_end - build_start).count() / 1e6;
+
+    TimingStats stats = time_repetitions([&]() {
+        execute_for_benchmark(circuit);
+    });
+
     double end_memory = get_memory_usage();
-    
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-    
+    MemoryStats memory = MemoryTelemetry::end();
+    size_t num_cnots = num_gates / 4;
+
     return {
         "Random-" + std::to_string(num_qubits) + "-" + std::to_string(num_gates),
         num_qubits,
         num_gates + num_cnots,
-        duration.count() / 1000.0,
+        stats.median_ms,
+        end_memory - start_memory,
+        memory,
+        num_gates + num_cnots,
+        num_threads(),
+        circuit.num_fused_operations(),
+        construction_ms,
+        stats,
+        repetitions_,
+        precision_name(),
+        seed
+    };
+}
+
+BenchmarkResult BenchmarkRunner::benchmark_noisy_random(size_t num_qubits, size_t num_gates,
+                                                        size_t num_trajectories,
+                                                        uint64_t seed) {
+    double start_memory = get_memory_usage();
+    MemoryTelemetry::begin();
+
+    // Same cached circuit as the noiseless random case, so the pair
+    // isolates the cost of the noise channels and the trajectory count.
+    auto build_start = std::chrono::high_resolution_clock::now();
+    std::vector<QuantumCircuit> cached;
+    {
+        std::lock_guard<std::mutex> lock(random_circuit_cache_mutex);
+        auto key = std::make_tuple(seed, num_qubits, num_gates);
+        auto it = random_circuit_cache.find(key);
+        if (it == random_circuit_cache.end()) {
+            it = random_circuit_cache
+                     .emplace(key, generate_random_circuit(num_qubits, num_gates, seed))
+                     .first;
+        }
+        cached.push_back(it->second);
+    }
+    QuantumCircuit circuit = cached.front();
+    circuit.with_noise({0.001, 0.001});
+    auto build_end = std::chrono::high_resolution_clock::now();
+    double construction_ms =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(build_end - build_start).count() / 1e6;
+
+    TimingStats stats = time_repetitions([&]() {
+        auto probabilities = circuit.execute_trajectories(num_trajectories, seed);
+        (void)probabilities;
+    });
+
+    double end_memory = get_memory_usage();
+    MemoryStats memory = MemoryTelemetry::end();
+    size_t num_cnots = num_gates / 4;
+
+    return {
+        "NoisyRandom-" + std::to_string(num_qubits) + "-" + std::to_string(num_trajectories),
+        num_qubits,
+        num_gates + num_cnots,
+        stats.median_ms,
         end_memory - start_memory,
-        num_gates + num_cnots
+        memory,
+        num_gates + num_cnots,
+        num_threads(),
+        circuit.num_fused_operations(),
+        construction_ms,
+        stats,
+        repetitions_,
+        precision_name(),
+        seed
     };
 }
 
 BenchmarkResult BenchmarkRunner::benchmark_qft_circuit(size_t num_qubits) {
     double start_memory = get_memory_usage();
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
+    MemoryTelemetry::begin();
+
+    auto build_start = std::chrono::high_resolution_clock::now();
     QuantumCircuit circuit(num_qubits);
-    
+
     for (size_t i = 0; i < num_qubits; ++i) {
         circuit.h(i);
         for (size_t j = i + 1; j < num_qubits; ++j) {
-            double angle = PI / (1ULL << (j - i));
-            circuit.rz(j, angle);
-            circuit.cnot(j, i);
-            circuit.rz(j, -angle);
-            circuit.cnot(j, i);
+            circuit.cp(j, i, PI / (1ULL << (j - i)));
         }
     }
-    
-    auto final_state = circuit.execute();
-    
-    auto end_time = std::chrono::high_resolution_clock::now();
+    auto build_end = std::chrono::high_resolution_clock::now();
+    double construction_ms =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(build_end - build_start).count() / 1e6;
+
+    TimingStats stats = time_repetitions([&]() {
+        execute_for_benchmark(circuit);
+    });
+
     double end_memory = get_memory_usage();
-    
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-    size_t num_gates = num_qubits + (num_qubits * (num_qubits - 1)) * 2;
-    
+    MemoryStats memory = MemoryTelemetry::end();
+    size_t num_gates = num_qubits + num_qubits * (num_qubits - 1) / 2;
+
     return {
         "QFT-" + std::to_string(num_qubits),
         num_qubits,
         num_gates,
-        duration.count() / 1000.0,
+        stats.median_ms,
+        end_memory - start_memory,
+        memory,
+        num_qubits * 2,
+        num_threads(),
+        circuit.num_fused_operations(),
+        construction_ms,
+        stats,
+        repetitions_,
+        precision_name(),
+        0
+    };
+}
+
+BenchmarkResult BenchmarkRunner::benchmark_vqe_ansatz(size_t num_qubits, size_t num_layers) {
+    double start_memory = get_memory_usage();
+    MemoryTelemetry::begin();
+
+    auto build_start = std::chrono::high_resolution_clock::now();
+    QuantumCircuit circuit(num_qubits);
+    std::mt19937 gen(42);  // fixed parameters so every run times the same ansatz
+    std::uniform_real_distribution<> angle_dist(0.0, 2.0 * PI);
+
+    for (size_t layer = 0; layer < num_layers; ++layer) {
+        for (size_t q = 0; q < num_qubits; ++q) {
+            circuit.ry(q, angle_dist(gen));
+            circuit.rz(q, angle_dist(gen));
+        }
+        for (size_t q = 0; q + 1 < num_qubits; ++q) {
+            circuit.cnot(q, q + 1);
+        }
+    }
+
+    // Transverse-field Ising observables: Z_q Z_{q+1} couplings plus an X
+    // term per qubit, measured after every execution like a VQE iteration.
+    std::vector<PauliString> observables;
+    for (size_t q = 0; q + 1 < num_qubits; ++q) {
+        std::string paulis(num_qubits, 'I');
+        paulis[q] = 'Z';
+        paulis[q + 1] = 'Z';
+        observables.emplace_back(paulis);
+    }
+    for (size_t q = 0; q < num_qubits; ++q) {
+        std::string paulis(num_qubits, 'I');
+        paulis[q] = 'X';
+        observables.emplace_back(paulis);
+    }
+    auto build_end = std::chrono::high_resolution_clock::now();
+    double construction_ms =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(build_end - build_start).count() / 1e6;
+
+    double energy = 0.0;
+    TimingStats stats = time_repetitions([&]() {
+        energy = 0.0;
+        if (precision_ == Precision::SINGLE) {
+            auto state = circuit.execute_single_precision();
+            for (const auto& observable : observables) {
+                energy += state.expectation(observable);
+            }
+        } else {
+            auto state = circuit.execute();
+            for (const auto& observable : observables) {
+                energy += state.expectation(observable);
+            }
+        }
+    });
+
+    double end_memory = get_memory_usage();
+    MemoryStats memory = MemoryTelemetry::end();
+    size_t num_gates = num_layers * (3 * num_qubits - 1);
+
+    return {
+        "VQE-" + std::to_string(num_qubits) + "-" + std::to_string(num_layers),
+        num_qubits,
+        num_gates,
+        stats.median_ms,
+        end_memory - start_memory,
+        memory,
+        num_layers * 3,
+        num_threads(),
+        circuit.num_fused_operations(),
+        construction_ms,
+        stats,
+        repetitions_,
+        precision_name(),
+        42
+    };
+}
+
+BenchmarkResult BenchmarkRunner::benchmark_circuit(const QuantumCircuit& circuit,
+                                                   const std::string& name) {
+    double start_memory = get_memory_usage();
+    MemoryTelemetry::begin();
+
+    TimingStats stats = time_repetitions([&]() {
+        execute_for_benchmark(circuit);
+    });
+
+    double end_memory = get_memory_usage();
+    MemoryStats memory = MemoryTelemetry::end();
+
+    return {
+        name,
+        circuit.num_qubits(),
+        circuit.num_operations(),
+        stats.median_ms,
         end_memory - start_memory,
-        num_qubits * 2
+        memory,
+        circuit.num_operations(),
+        num_threads(),
+        circuit.num_fused_operations(),
+        0.0,  // built (or parsed) off the timed path by the caller
+        stats,
+        repetitions_,
+        precision_name(),
+        0
+    };
+}
+
+// BenchmarkScheduler implementation
+namespace {
+
+// Pins the calling thread to one core so concurrent benchmark cases do not
+// migrate onto each other mid-measurement. No-op off Linux.
+void pin_to_core(size_t core) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % std::max(1u, std::thread::hardware_concurrency()), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)core;
+#endif
+}
+
+// Restores the full-machine affinity mask before an exclusive case runs.
+void unpin() {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned c = 0; c < cores; ++c) {
+        CPU_SET(c, &set);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+} // namespace
+
+void BenchmarkScheduler::add(size_t num_qubits, std::function<BenchmarkResult()> job,
+                             bool exclusive) {
+    jobs_.push_back({num_qubits, std::move(job), jobs_.size(), exclusive});
+}
+
+void BenchmarkScheduler::set_result_callback(std::function<void(const BenchmarkResult&)> callback) {
+    on_result_ = std::move(callback);
+}
+
+std::vector<BenchmarkResult> BenchmarkScheduler::run() {
+    std::vector<BenchmarkResult> results(jobs_.size());
+    std::mutex callback_mutex;
+    auto deliver = [&](const BenchmarkResult& result) {
+        if (on_result_) {
+            std::lock_guard<std::mutex> lock(callback_mutex);
+            on_result_(result);
+        }
     };
-}
\ No newline at end of file
+
+    std::vector<const Job*> concurrent;
+    std::vector<const Job*> exclusive;
+    for (const Job& job : jobs_) {
+        (job.num_qubits < kExclusiveThresholdQubits && !job.exclusive ? concurrent
+                                                                      : exclusive)
+            .push_back(&job);
+    }
+
+    // Small cases: one pinned worker per core pulls jobs off a shared
+    // counter until the queue drains.
+    size_t num_workers = std::min<size_t>(
+        concurrent.size(), std::max(1u, std::thread::hardware_concurrency()));
+    if (num_workers <= 1) {
+        for (const Job* job : concurrent) {
+            results[job->slot] = job->body();
+            deliver(results[job->slot]);
+        }
+    } else {
+        std::atomic<size_t> next{0};
+        std::vector<std::thread> workers;
+        workers.reserve(num_workers);
+        for (size_t w = 0; w < num_workers; ++w) {
+            workers.emplace_back([&, w]() {
+                pin_to_core(w);
+                for (size_t i = next.fetch_add(1); i < concurrent.size();
+                     i = next.fetch_add(1)) {
+                    results[concurrent[i]->slot] = concurrent[i]->body();
+                    deliver(results[concurrent[i]->slot]);
+                }
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Large cases keep the machine to themselves: the pool has drained and
+    // their OpenMP kernels fan out across every core.
+    unpin();
+    for (const Job* job : exclusive) {
+        results[job->slot] = job->body();
+        deliver(results[job->slot]);
+    }
+
+    jobs_.clear();
+    return results;
+}
+
+// BenchmarkPlanner implementation
+namespace {
+
+// MemAvailable is the kernel's estimate of what is allocatable without
+// swapping, which is the number that matters for a state vector; fall
+// back to free physical pages where /proc is absent.
+double probe_available_memory_mb() {
+    std::ifstream file("/proc/meminfo");
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.substr(0, 13) == "MemAvailable:") {
+            std::istringstream iss(line);
+            std::string label, value;
+            iss >> label >> value;
+            return std::stod(value) / 1024.0;
+        }
+    }
+    long pages = sysconf(_SC_AVPHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && page_size > 0) {
+        return static_cast<double>(pages) * page_size / (1024.0 * 1024.0);
+    }
+    return 0.0;
+}
+
+} // namespace
+
+static_assert(BenchmarkPlanner::kCalibrationQubits > QuantumCircuit::kFixedDispatchMaxQubits,
+              "calibration must time the dynamic path, not the fixed-size engine");
+
+BenchmarkPlanner::BenchmarkPlanner(const Budget& budget)
+    : budget_(budget), available_memory_mb_(probe_available_memory_mb()) {
+    // Calibrate the per-amplitude sweep rate on a GHZ-style ladder. The
+    // prediction model charges gates(n) raw sweeps, so the calibration
+    // circuit must not fuse away - a random circuit's single-qubit runs
+    // collapse under fusion and the measured rate comes out several times
+    // too low. Alternating h/cnot leaves one sweep per operation. The
+    // median of three runs rejects a cold-start outlier.
+    QuantumCircuit circuit(kCalibrationQubits);
+    for (size_t q = 0; q < kCalibrationQubits; ++q) {
+        circuit.h(q);
+    }
+    for (size_t q = 0; q + 1 < kCalibrationQubits; ++q) {
+        circuit.cnot(q, q + 1);
+    }
+    std::array<double, 3> samples;
+    for (double& sample : samples) {
+        auto start = std::chrono::high_resolution_clock::now();
+        auto state = circuit.execute();
+        auto end = std::chrono::high_resolution_clock::now();
+        (void)state;
+        sample = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    double amplitudes_swept = static_cast<double>(circuit.num_operations()) *
+                              static_cast<double>(1ULL << kCalibrationQubits);
+    sweep_ns_per_amplitude_ = samples[1] / amplitudes_swept;
+}
+
+size_t BenchmarkPlanner::max_qubits(const std::function<size_t(size_t)>& gates_for,
+                                    size_t live_states) const {
+    double memory_cap_mb = budget_.memory_mb > 0.0
+                               ? budget_.memory_mb
+                               : available_memory_mb_ * 0.5;
+    size_t best = kMinQubits;
+    for (size_t n = kMinQubits; n <= kMaxQubits; ++n) {
+        double amplitudes = static_cast<double>(1ULL << n);
+        double predicted_ms =
+            static_cast<double>(gates_for(n)) * amplitudes * sweep_ns_per_amplitude_ / 1e6;
+        double predicted_mb =
+            static_cast<double>(live_states) * amplitudes * 16.0 / (1024.0 * 1024.0);
+        if (predicted_ms > budget_.time_ms || predicted_mb > memory_cap_mb) {
+            break;
+        }
+        best = n;
+    }
+    return best;
+}
+
+std::vector<size_t> BenchmarkPlanner::plan(const std::function<size_t(size_t)>& gates_for,
+                                           size_t live_states) const {
+    size_t frontier = max_qubits(gates_for, live_states);
+    std::vector<size_t> sizes;
+    for (size_t n = kMinQubits; n <= frontier && n <= 12; n += 2) {
+        sizes.push_back(n);
+    }
+    if (sizes.empty() || sizes.back() != frontier) {
+        sizes.push_back(frontier);
+    }
+    return sizes;
+}
+
+// Profiler implementation
+bool Profiler::enabled() {
+#ifdef QSIM_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Profiler::reset() {
+#ifdef QSIM_PROFILE
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    profile_buckets.clear();
+#endif
+}
+
+std::vector<ProfileEntry> Profiler::report() {
+    std::vector<ProfileEntry> entries;
+#ifdef QSIM_PROFILE
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    for (const auto& [kind, bucket] : profile_buckets) {
+        ProfileEntry entry;
+        entry.kind = kind;
+        entry.calls = bucket.calls;
+        entry.cycles = bucket.cycles;
+        entry.time_ms = bucket.time_ns / 1e6;
+        entry.amplitudes_swept = bucket.amplitudes;
+        entry.bandwidth_gbps =
+            bucket.time_ns > 0.0 ? static_cast<double>(bucket.bytes) / bucket.time_ns : 0.0;
+        entries.push_back(std::move(entry));
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const ProfileEntry& a, const ProfileEntry& b) {
+                  return a.time_ms > b.time_ms;
+              });
+#endif
+    return entries;
+}
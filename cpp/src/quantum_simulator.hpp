@@ -1,32 +1,282 @@
 #pragma once
 
 #include <complex>
+#include <functional>
 #include <vector>
 #include <memory>
 #include <string>
 #include <chrono>
+#include <unordered_map>
 #include <Eigen/Dense>
 
 using Complex = std::complex<double>;
-using StateVector = Eigen::VectorXcd;
 using Gate = Eigen::Matrix2cd;
 
-class QuantumState {
+// State vectors are parameterized on the scalar type: double is the default,
+// float halves memory footprint and bandwidth for benchmarks that do not
+// need the extra precision. Gate matrices stay double and are narrowed at
+// application time.
+template <typename Scalar>
+using StateVectorT = Eigen::Matrix<std::complex<Scalar>, Eigen::Dynamic, 1>;
+using StateVector = StateVectorT<double>;
+
+// Recycles state-vector buffers between QuantumState instances so repeated
+// benchmark runs are allocation-free after warmup. Buffers are matched by
+// size; callers get them back uninitialized. Each scalar type has its own
+// pool.
+template <typename Scalar>
+class StateBufferPoolT {
 public:
-    explicit QuantumState(size_t num_qubits);
-    
+    static StateVectorT<Scalar> acquire(size_t size);
+    static void release(StateVectorT<Scalar>&& buffer);
+};
+using StateBufferPool = StateBufferPoolT<double>;
+
+// Amplitude storage in a memory-mapped scratch file instead of the heap,
+// for states larger than RAM: the OS pages the file in and out under
+// MADV_SEQUENTIAL, which matches the ascending sweeps of every kernel,
+// instead of swap-thrashing an anonymous allocation. The file is unlinked
+// at creation, so it disappears with the mapping. An empty buffer (null
+// data) signals that mapping is unavailable and the caller should fall
+// back to the heap.
+template <typename Scalar>
+class MappedStateBufferT {
+public:
+    MappedStateBufferT() = default;
+    explicit MappedStateBufferT(size_t size);
+    ~MappedStateBufferT();
+
+    MappedStateBufferT(const MappedStateBufferT&) = delete;
+    MappedStateBufferT& operator=(const MappedStateBufferT&) = delete;
+    MappedStateBufferT(MappedStateBufferT&& other) noexcept;
+    MappedStateBufferT& operator=(MappedStateBufferT&& other) noexcept;
+
+    std::complex<Scalar>* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    std::complex<Scalar>* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Structure class of a 2x2 gate. Tagged once at circuit construction so
+// the execution engine dispatches straight to the matching streaming
+// kernel instead of re-inspecting the matrix on every application:
+// DIAGONAL gates scale amplitudes in place (no pairing, half the memory
+// traffic), PERMUTATION gates are a scaled swap of the pair.
+enum class GateClass { GENERAL, DIAGONAL, PERMUTATION };
+
+// Tensor product of single-qubit Paulis, written qubit 0 first: "XZIY" is
+// X on qubit 0, Z on qubit 1, Y on qubit 3; any other character is the
+// identity. Stored as bit masks so the expectation kernel is branch-free
+// per amplitude.
+class PauliString {
+public:
+    explicit PauliString(const std::string& paulis);
+
+    // Qubits whose basis bit P flips (X and Y positions).
+    size_t flip_mask() const { return flip_mask_; }
+    // Qubits contributing a (-1)^bit sign (Y and Z positions).
+    size_t phase_mask() const { return phase_mask_; }
+    size_t num_y() const { return num_y_; }
+
+private:
+    size_t flip_mask_;
+    size_t phase_mask_;
+    size_t num_y_;
+};
+
+// One constant-folded initial-state factor: the column a single-qubit
+// gate prefix applies to |0> on one qubit. The execution engine folds a
+// leading layer of single-qubit gates on |0...0> into these.
+struct ProductFactor {
+    size_t qubit;
+    Complex zero;   // amplitude it leaves on |0>
+    Complex one;    // amplitude it leaves on |1>
+};
+
+template <typename Scalar>
+class QuantumStateT {
+public:
+    using Amplitude = std::complex<Scalar>;
+
+    enum class Backend { HEAP, MAPPED };
+
+    // Page placement of the amplitude array on NUMA machines, applied by
+    // the first-touch zeroing pass in reset() and shared by both storage
+    // backends. FIRST_TOUCH partitions the pass the same static way the
+    // threaded gate kernels partition their sweeps, so each thread's pages
+    // land on its own node; INTERLEAVE stripes the pass page by page so a
+    // state driven from one thread still spreads across nodes.
+    enum class Placement { FIRST_TOUCH, INTERLEAVE };
+
+    // Picks the backend by size: heap below kMappedThresholdQubits, the
+    // memory-mapped file at or above it.
+    explicit QuantumStateT(size_t num_qubits);
+    QuantumStateT(size_t num_qubits, Backend backend);
+    QuantumStateT(size_t num_qubits, Backend backend, Placement placement);
+    ~QuantumStateT();
+
+    QuantumStateT(const QuantumStateT& other);
+    QuantumStateT& operator=(const QuantumStateT& other);
+    QuantumStateT(QuantumStateT&& other) noexcept;
+    QuantumStateT& operator=(QuantumStateT&& other) noexcept;
+
+    Backend backend() const { return backend_; }
+    Placement placement() const { return placement_; }
+
+    // Re-initializes the borrowed buffer to |0...0> without reallocating.
+    void reset();
+
+    // Builds the product state given by the factors directly, doubling the
+    // filled subspace once per factor: total work is a single sweep instead
+    // of one butterfly sweep per gate (an H layer on n qubits becomes one
+    // uniform fill). Precondition: the state is |0...0>.
+    void initialize_product(const std::vector<ProductFactor>& factors);
+
     void apply_single_gate(const Gate& gate, size_t qubit);
+
+    // Pre-classified variant: skips matrix inspection when the caller
+    // already tagged the gate (the circuit engine tags at construction).
+    void apply_single_gate(const Gate& gate, size_t qubit, GateClass gate_class);
+
     void apply_controlled_gate(const Gate& gate, size_t control, size_t target);
-    
+
+    // Controlled-phase is diagonal: it scales the amplitudes with both bits
+    // set by the phase factor, with no amplitude pairing or matrix multiply.
+    void apply_controlled_phase(const Complex& phase, size_t control, size_t target);
+
+    // Arbitrary 4x4 unitary on (q0, q1); q0 addresses the low bit of the
+    // matrix index. One gather/multiply/scatter per amplitude quad.
+    void apply_two_qubit_gate(const Eigen::Matrix4cd& gate, size_t q0, size_t q1);
+
+    // Butterfly on the target restricted to the subspace where every control
+    // bit is set: a 2^(n-k-1)-sized loop, not a full scan with bit tests.
+    void apply_multi_controlled_gate(const Gate& gate, const std::vector<size_t>& controls,
+                                     size_t target);
+
+    // Applies a 2^k x 2^k gate to the k listed qubits in one sweep, so each
+    // amplitude is loaded once per gate group instead of once per gate.
+    // qubits[0] addresses the least significant bit of the block index.
+    void apply_block_gate(const Eigen::MatrixXcd& gate, const std::vector<size_t>& qubits);
+
     double get_probability(size_t state) const;
+
+    // <psi|P|psi> for a Pauli string in one fused pass: P maps |i> to a
+    // phase times |i ^ flip>, so every term is a conjugated product of two
+    // amplitudes and no intermediate state is materialized.
+    double expectation(const PauliString& pauli) const;
+
+    // Bulk export of |amplitude|^2 into a caller-provided buffer of size()
+    // entries; vectorized, unlike size() calls to get_probability.
+    void probabilities_into(double* out, size_t count) const;
+
+    // Rearranges the amplitudes so the index bit at position p moves to
+    // position to[p] (to must be a permutation of 0..n-1): one gather
+    // sweep through pool scratch, touching only the bits that actually
+    // move. The execute() remapping layer uses this to fold its final
+    // logical-to-physical qubit permutation back out.
+    void permute_qubits(const std::vector<size_t>& to);
+
+    // Draws num_shots measurement outcomes. One pass builds the cumulative
+    // distribution, then each shot is a binary search, so shot cost is
+    // independent of further state-vector sweeps.
+    std::vector<size_t> sample(size_t num_shots, uint64_t seed) const;
+
+    // Writes the state to a checkpoint file: a one-page header followed by
+    // the raw amplitude array at a page-aligned offset, so load() can map
+    // the payload back with no deserialization pass.
+    void save(const std::string& path) const;
+
+    // Reconstructs a state from a save() checkpoint. Where the platform
+    // allows it the amplitudes are mapped copy-on-write straight out of
+    // the file: the load itself is O(1), pages fault in on first touch,
+    // and only the pages a subsequent suffix actually writes are copied.
+    // Throws std::runtime_error on a missing or incompatible file.
+    static QuantumStateT load(const std::string& path);
+
+    // In-memory checkpoint: snapshot() writes the amplitudes once to an
+    // unlinked scratch file (the MappedStateBufferT pattern), restore()
+    // swaps the live storage for a fresh copy-on-write mapping of it.
+    // Rewinding before each suffix run therefore costs no sweep - pages
+    // the suffix never writes stay shared with the snapshot. restore()
+    // without a prior snapshot() throws std::runtime_error.
+    void snapshot();
+    void restore();
+    bool has_snapshot() const {
+        return snapshot_fd_ >= 0 || snapshot_copy_.size() > 0;
+    }
+
     size_t size() const { return amplitudes_.size(); }
     size_t num_qubits() const { return num_qubits_; }
 
+    // Raw amplitude storage, in computational-basis order. The fixed-size
+    // execution engine fills the returned state through this.
+    Amplitude* data() { return amplitudes_.data(); }
+    const Amplitude* data() const { return amplitudes_.data(); }
+
+    // Debug/verification switch: when enabled, gates go through the original
+    // copying kernels (full state-vector copy per gate) instead of the
+    // in-place butterfly updates. Useful for cross-checking kernel changes.
+    static void set_verification_mode(bool enabled);
+    static bool verification_mode();
+
+    // States below this qubit count are updated serially; the per-gate work
+    // is too small to amortize the OpenMP fork/join overhead.
+    static constexpr size_t kParallelThresholdQubits = 14;
+
+    // Widest gate group the block kernel is sized for (scratch buffers and
+    // the extra flops per amplitude grow as 2^k).
+    static constexpr size_t kMaxBlockQubits = 5;
+
+    // 16 GiB of double-precision amplitudes: states this wide exceed RAM on
+    // much of the benchmark fleet, so they default to the mapped backend.
+    static constexpr size_t kMappedThresholdQubits = 30;
+
 private:
-    StateVector amplitudes_;
+    bool use_parallel_kernel() const {
+        return num_qubits_ >= kParallelThresholdQubits;
+    }
+
+    void apply_single_gate_copying(const Gate& gate, size_t qubit);
+    void apply_controlled_gate_copying(const Gate& gate, size_t control, size_t target);
+
+    // Structured-gate fast paths: diagonal gates (pauli_z, rz) scale
+    // amplitudes without pairing, antidiagonal gates (pauli_x, pauli_y)
+    // reduce to a scaled swap of the pair.
+    void apply_diagonal_gate(const Complex& d0, const Complex& d1, size_t qubit);
+    void apply_antidiagonal_gate(const Complex& g01, const Complex& g10, size_t qubit);
+    void apply_single_gate_generic(const Gate& gate, size_t qubit);
+
+    // Adopts the state from an existing copy-on-write mapping without
+    // allocating or zeroing storage; used by load().
+    QuantumStateT(size_t num_qubits, Amplitude* cow_data);
+
+    // Swaps the live storage for a private (copy-on-write) file mapping,
+    // releasing whatever storage was active before.
+    void adopt_cow_mapping(Amplitude* data);
+    void release_cow_mapping();
+
+    // amplitudes_ views whichever storage the backend selected: heap_ is
+    // pool-backed, mapped_ is the scratch-file mapping, cow_data_ is a
+    // private checkpoint mapping installed by load()/restore(). The
+    // kernels only ever see the map.
+    StateVectorT<Scalar> heap_;
+    MappedStateBufferT<Scalar> mapped_;
+    Eigen::Map<StateVectorT<Scalar>> amplitudes_;
     size_t num_qubits_;
+    Backend backend_;
+    Placement placement_;
+    Amplitude* cow_data_ = nullptr;
+    int snapshot_fd_ = -1;
+    StateVectorT<Scalar> snapshot_copy_;  // fallback when scratch files fail
+
+    static bool verification_mode_;
 };
 
+using QuantumState = QuantumStateT<double>;
+using QuantumStateF = QuantumStateT<float>;
+
 class Gates {
 public:
     static Gate pauli_x();
@@ -36,22 +286,125 @@ public:
     static Gate rx(double theta);
     static Gate ry(double theta);
     static Gate rz(double theta);
+    static Gate phase(double theta);
 };
 
 struct Operation {
-    enum Type { SINGLE_GATE, CONTROLLED_GATE };
-    
+    enum Type {
+        SINGLE_GATE,
+        CONTROLLED_GATE,
+        CONTROLLED_PHASE,
+        MULTI_CONTROLLED_GATE,
+        TWO_QUBIT_GATE
+    };
+
+    // Rotation axis tag set by the rx/ry/rz builders, so execute_batch can
+    // rebind the angle per batch entry. Fusion drops the tag (the angle is
+    // baked into the fused product).
+    enum class Rotation { NONE, RX, RY, RZ };
+
     Type type;
     Gate gate;
     size_t qubit;
-    size_t control;
+    size_t control;     // also the low matrix bit of TWO_QUBIT_GATE
     size_t target;
+    std::vector<size_t> controls;   // MULTI_CONTROLLED_GATE only
+    Eigen::Matrix4cd two_qubit_gate;  // TWO_QUBIT_GATE only
+    GateClass gate_class = GateClass::GENERAL;  // SINGLE_GATE dispatch tag
+    Rotation rotation = Rotation::NONE;
+    double angle = 0.0;
+};
+
+// Companion to StateBufferPool for Operation storage: circuits borrow their
+// operation vectors here, so rebuilding a circuit every repetition reuses
+// the grown capacity instead of re-growing from empty.
+class OperationArena {
+public:
+    static std::vector<Operation> acquire();
+    static void release(std::vector<Operation>&& operations);
+};
+
+// Sparse state vector: only nonzero amplitudes are stored, keyed by
+// basis index, so GHZ- and Clifford-style circuits with few branches run
+// in time and memory proportional to the nonzero count instead of 2^n.
+// The gate interface mirrors QuantumStateT; apply() walks a fused
+// operation stream the way the distributed backend does. When a circuit
+// entangles enough that the fill fraction crosses kPromoteDensity the
+// state promotes itself to a dense QuantumStateT once and delegates from
+// then on - past that density the hash map costs more per amplitude than
+// the streaming kernels.
+template <typename Scalar>
+class SparseQuantumStateT {
+public:
+    using Amplitude = std::complex<Scalar>;
+
+    explicit SparseQuantumStateT(size_t num_qubits);
+
+    void apply(const std::vector<Operation>& ops);
+    void apply_operation(const Operation& op);
+
+    void apply_single_gate(const Gate& gate, size_t qubit);
+    void apply_single_gate(const Gate& gate, size_t qubit, GateClass gate_class);
+    void apply_controlled_gate(const Gate& gate, size_t control, size_t target);
+    void apply_controlled_phase(const Complex& phase, size_t control, size_t target);
+    void apply_two_qubit_gate(const Eigen::Matrix4cd& gate, size_t q0, size_t q1);
+    void apply_multi_controlled_gate(const Gate& gate, const std::vector<size_t>& controls,
+                                     size_t target);
+
+    double get_probability(size_t state) const;
+
+    size_t num_qubits() const { return num_qubits_; }
+
+    // Stored amplitude count: the map size while sparse, 2^n once dense.
+    size_t num_nonzero() const;
+    bool is_dense() const { return dense_ != nullptr; }
+
+    // Fill fraction at which the dense representation wins: a hash entry
+    // costs several times a dense slot and every update is a lookup
+    // instead of a streamed sweep. One promotion, never demoted.
+    static constexpr double kPromoteDensity = 0.25;
+
+    // Amplitudes below this magnitude (probability < 1e-32) are dropped
+    // after each update; exact gate cancellations would otherwise leave
+    // the map littered with rounding residue.
+    static constexpr double kPruneThreshold = 1e-16;
+
+private:
+    using AmplitudeMap = std::unordered_map<size_t, Amplitude>;
+
+    void insert_pruned(AmplitudeMap& amps, size_t index, const Amplitude& value) const;
+    void promote_if_dense();
+
+    size_t num_qubits_;
+    AmplitudeMap amplitudes_;
+    std::unique_ptr<QuantumStateT<Scalar>> dense_;
+};
+
+using SparseQuantumState = SparseQuantumStateT<double>;
+
+// One assignment of the circuit's rotation angles, in declaration order.
+using ParameterSet = std::vector<double>;
+
+// Per-gate noise channels for the stochastic trajectory mode. After every
+// operation each involved qubit suffers, in order, depolarizing noise (a
+// uniformly random Pauli applied with the given probability) and amplitude
+// damping (|1> decays to |0> with rate gamma), realized as quantum-jump
+// trajectories so each trajectory stays a pure state.
+struct NoiseModel {
+    double depolarizing = 0.0;        // probability of a random Pauli per qubit per gate
+    double amplitude_damping = 0.0;   // decay rate gamma per qubit per gate
 };
 
 class QuantumCircuit {
 public:
     explicit QuantumCircuit(size_t num_qubits);
-    
+    ~QuantumCircuit();
+
+    QuantumCircuit(const QuantumCircuit&) = default;
+    QuantumCircuit& operator=(const QuantumCircuit&) = default;
+    QuantumCircuit(QuantumCircuit&&) = default;
+    QuantumCircuit& operator=(QuantumCircuit&&) = default;
+
     QuantumCircuit& h(size_t qubit);
     QuantumCircuit& x(size_t qubit);
     QuantumCircuit& y(size_t qubit);
@@ -60,24 +413,272 @@ public:
     QuantumCircuit& ry(size_t qubit, double theta);
     QuantumCircuit& rz(size_t qubit, double theta);
     QuantumCircuit& cnot(size_t control, size_t target);
-    
+    QuantumCircuit& cp(size_t control, size_t target, double theta);
+    QuantumCircuit& cgate(const Gate& gate, size_t control, size_t target);
+    QuantumCircuit& ccx(size_t control1, size_t control2, size_t target);
+    QuantumCircuit& gate2(const Eigen::Matrix4cd& gate, size_t q1, size_t q2);
+
     QuantumState execute() const;
-    
+    QuantumStateF execute_single_precision() const;
+
+    // Executes the circuit once per parameter set, all in one pass: B
+    // state vectors are held interleaved (batch innermost) and every gate
+    // is applied to all B of them in one sweep, with rotation angles
+    // rebound per batch entry. Amortizes gate decode across the batch and
+    // makes the inner loops unit-stride over it. Double precision; each
+    // set must provide num_parameters() angles.
+    std::vector<QuantumState> execute_batch(
+        const std::vector<ParameterSet>& parameter_sets) const;
+
+    // Angles execute_batch expects per parameter set: one for each
+    // rx/ry/rz, in declaration order.
+    size_t num_parameters() const;
+
+    // Attaches per-gate noise channels for execute_trajectories; chains
+    // like the gate builders. Noiseless entry points ignore the model.
+    QuantumCircuit& with_noise(const NoiseModel& model);
+    const NoiseModel& noise() const { return noise_; }
+    bool has_noise() const { return has_noise_; }
+
+    // Noisy execution by Monte Carlo: runs num_trajectories independent
+    // quantum-jump trajectories of the circuit with the attached noise
+    // model and returns the trajectory-averaged probabilities (the
+    // diagonal of the estimated density matrix). Trajectories are
+    // embarrassingly parallel and run across threads, each worker reusing
+    // one pooled state buffer; a counter-based RNG keyed on (seed,
+    // trajectory index) gives every trajectory its own reproducible
+    // stream with no shared mutable state. Noise attaches per built gate,
+    // so the walk is over the raw (unfused) operations.
+    std::vector<double> execute_trajectories(size_t num_trajectories,
+                                             uint64_t seed) const;
+
+    // Fuses runs of single-qubit gates on the same qubit into one 2x2 gate
+    // before execution. Single-qubit gates on different qubits commute, so a
+    // run may span gates on other qubits; controlled gates act as barriers
+    // for their control and target. Fused products that reduce to the
+    // identity are dropped entirely.
+    std::vector<Operation> fused_operations() const;
+    size_t num_fused_operations() const;
+
     size_t num_qubits() const { return num_qubits_; }
     size_t num_operations() const { return operations_.size(); }
 
+    // Large states are memory-bandwidth-bound, so execute() schedules fused
+    // operations into multi-qubit blocks (up to kBlockQubits wide) and applies
+    // each block as a single cache-blocked sweep. Below this qubit count the
+    // extra 2^k flops per amplitude cost more than the saved bandwidth.
+    static constexpr size_t kBlockScheduleThresholdQubits = 18;
+    static constexpr size_t kBlockQubits = 4;
+
+    // At or below this qubit count the state fits in L1/L2 and kernel time
+    // is loop overhead, not memory traffic, so execute() dispatches to a
+    // fixed-size engine whose trip counts are compile-time constants (one
+    // engine instantiation per width, selected through a jump table).
+    static constexpr size_t kFixedDispatchMaxQubits = 12;
+
+    // Qubit-remapping layer, enabled at kRemapThresholdQubits and above:
+    // a butterfly on physical position p strides 1<<p between pair
+    // members, so positions at or past kRemapHighQubit leave every level
+    // of cache behind. When the kRemapWindow-operation lookahead shows a
+    // high qubit used kRemapMinUses times or more, one SWAP pass moves it
+    // into a cold low position and the logical-to-physical map keeps the
+    // following gates cache-resident; the final permutation is folded out
+    // with one permute_qubits gather.
+    static constexpr size_t kRemapThresholdQubits = 20;
+    static constexpr size_t kRemapHighQubit = 16;
+    static constexpr size_t kRemapWindow = 24;
+    static constexpr size_t kRemapMinUses = 3;
+
 private:
+    template <typename Scalar>
+    QuantumStateT<Scalar> execute_impl() const;
+
+    template <typename Scalar>
+    void execute_blocked(QuantumStateT<Scalar>& state, const std::vector<Operation>& ops) const;
+
     size_t num_qubits_;
     std::vector<Operation> operations_;
+    NoiseModel noise_;
+    bool has_noise_ = false;
+};
+
+// Loads circuits from the OpenQASM 2 subset the builder API can express:
+// one qreg, the gates h/x/y/z/rx/ry/rz/cx/cp/cu1/ccx, with angle
+// expressions of the form [-][n*]pi[/d] or a plain literal. Everything
+// else that is harmless (OPENQASM/include/creg/barrier/measure) is
+// skipped; anything unrecognized throws std::runtime_error. Checked-in
+// circuit files let every language entry execute byte-identical gates.
+class QasmLoader {
+public:
+    static QuantumCircuit load_file(const std::string& path);
+    static QuantumCircuit parse(const std::string& source);
+};
+
+// Memory usage observed during one telemetry window (one benchmark case).
+struct MemoryStats {
+    double peak_rss_mb;     // high-water resident set inside the window
+    double peak_heap_mb;    // high-water live heap inside the window
+    double allocated_mb;    // total bytes allocated inside the window
+};
+
+// Samples /proc RSS and the heap counters from a background thread while a
+// window is open, so transient spikes (e.g. the copying kernels' full
+// state duplicate) show up in the peak instead of vanishing between a
+// before/after delta. Windows are per-thread: concurrent benchmark cases
+// each get their own sampler. Heap counters cover global new/delete plus
+// the pool and mapped-buffer allocations that bypass it.
+class MemoryTelemetry {
+public:
+    static void begin();
+    static MemoryStats end();
+
+    // Explicit accounting for allocations operator new cannot see (Eigen
+    // state buffers go through raw aligned malloc).
+    static void record_allocation(size_t bytes);
+    static void record_release(size_t bytes);
+};
+
+// One row of the opt-in execution profile: totals for one operation kind
+// (e.g. "single:diagonal", "controlled", "block") accumulated across every
+// circuit executed since the last reset.
+struct ProfileEntry {
+    std::string kind;
+    size_t calls;
+    uint64_t cycles;
+    double time_ms;
+    size_t amplitudes_swept;    // amplitudes loaded and stored, summed
+    double bandwidth_gbps;      // effective: swept bytes / elapsed time
+};
+
+// Per-gate-kind instrumentation for QuantumCircuit::execute. Only a
+// QSIM_PROFILE build (cmake -DENABLE_PROFILING=ON) records anything; the
+// default build compiles the probes out entirely, so profiling can never
+// perturb the timings it is meant to explain.
+class Profiler {
+public:
+    static bool enabled();
+    static void reset();
+
+    // Accumulated entries sorted by total time, descending. Empty in
+    // non-profiling builds.
+    static std::vector<ProfileEntry> report();
+};
+
+// Execution-time statistics over the timed repetitions of one benchmark.
+struct TimingStats {
+    double min_ms;
+    double median_ms;
+    double p95_ms;
+    double stddev_ms;
 };
 
 struct BenchmarkResult {
     std::string name;
     size_t num_qubits;
     size_t num_gates;
-    double execution_time_ms;
+    double execution_time_ms;   // median over repetitions
     double memory_usage_mb;
+    MemoryStats memory;
     size_t circuit_depth;
+    size_t num_threads;
+    size_t num_fused_gates;
+    double construction_time_ms;
+    TimingStats timing;
+    size_t repetitions;
+    std::string precision;
+    uint64_t seed;      // RNG seed for generated circuits, 0 if fixed
+};
+
+// Runs independent benchmark cases concurrently. Every case is
+// self-contained (it builds its own circuit and state), so cases below the
+// exclusive threshold run on a pool of worker threads, each pinned to its
+// own core so concurrent cases do not migrate onto each other's timing.
+// Cases at or above the threshold use the OpenMP parallel kernels and get
+// the whole machine to themselves after the pool drains. Results come back
+// in submission order.
+class BenchmarkScheduler {
+public:
+    // Cases this wide run exclusively; below it the per-case state fits in
+    // cache and the serial kernels leave the other cores idle.
+    static constexpr size_t kExclusiveThresholdQubits =
+        QuantumState::kParallelThresholdQubits;
+
+    // exclusive forces a case onto the exclusive path regardless of
+    // width: cases that open their own OpenMP team (e.g. trajectory
+    // parallelism) would otherwise inherit a pool worker's single-core
+    // pin and oversubscribe the whole team onto it.
+    void add(size_t num_qubits, std::function<BenchmarkResult()> job,
+             bool exclusive = false);
+    std::vector<BenchmarkResult> run();
+
+    // Invoked with each result the moment its case completes (serialized
+    // across workers), so callers can stream partial output as the run
+    // progresses instead of waiting for the whole suite.
+    void set_result_callback(std::function<void(const BenchmarkResult&)> callback);
+
+private:
+    struct Job {
+        size_t num_qubits;
+        std::function<BenchmarkResult()> body;
+        size_t slot;
+        bool exclusive;
+    };
+
+    std::vector<Job> jobs_;
+    std::function<void(const BenchmarkResult&)> on_result_;
+};
+
+// Plans the benchmark sweep for the machine it runs on instead of a fixed
+// grid: probes available memory, calibrates the per-amplitude sweep cost
+// with one small timed run, and grows each family's qubit count until the
+// predicted case cost hits a time or memory budget. A big host gets its
+// frontier point automatically; a small one stops before the state no
+// longer fits. Prediction uses the dense cost model - gates(n) x 2^n
+// amplitudes at the calibrated rate, 16 bytes per amplitude per live
+// state - which upper-bounds the sparse and fixed-dispatch paths.
+class BenchmarkPlanner {
+public:
+    struct Budget {
+        double time_ms = 2000.0;   // predicted time for one execution of a case
+        double memory_mb = 0.0;    // 0 derives the cap from available memory
+    };
+
+    explicit BenchmarkPlanner(const Budget& budget);
+
+    // Largest qubit count whose predicted cost fits the budget.
+    // gates_for(n) is the family's sweep count at n qubits; live_states is
+    // how many full state vectors the case holds at once (scratch buffers
+    // and batches included).
+    size_t max_qubits(const std::function<size_t(size_t)>& gates_for,
+                      size_t live_states = 2) const;
+
+    // The family's qubit grid: the classic small sizes filtered to the
+    // frontier, plus the frontier itself - so cross-machine reports share
+    // the small points and each machine adds its largest feasible one.
+    std::vector<size_t> plan(const std::function<size_t(size_t)>& gates_for,
+                             size_t live_states = 2) const;
+
+    double available_memory_mb() const { return available_memory_mb_; }
+    double sweep_ns_per_amplitude() const { return sweep_ns_per_amplitude_; }
+
+    static constexpr size_t kMinQubits = 4;
+    // Hard cap: past this even the index math assumptions (size_t bit
+    // budget, pool buffer sizes) deserve a manual review, not a planner.
+    static constexpr size_t kMaxQubits = 34;
+    // Calibration must run the path the frontier cases run. At or below
+    // QuantumCircuit::kFixedDispatchMaxQubits the fixed-size engine
+    // executes out of L1, and up to ~16 qubits the state still fits in
+    // cache; either way the measured rate underestimates the DRAM-bound
+    // large cases by 4-10x and the budget becomes decorative. 18 qubits
+    // is past the last cache level on current parts and is the block-
+    // scheduling threshold, so the timed run uses the same kernels and
+    // the same memory system as the cases being predicted.
+    static constexpr size_t kCalibrationQubits = 18;
+
+private:
+    Budget budget_;
+    double available_memory_mb_;
+    double sweep_ns_per_amplitude_;
 };
 
 struct BenchmarkSuite {
@@ -89,10 +690,64 @@ struct BenchmarkSuite {
 
 class BenchmarkRunner {
 public:
+    enum class Precision { DOUBLE, SINGLE };
+
     static BenchmarkResult benchmark_ghz_state(size_t num_qubits);
-    static BenchmarkResult benchmark_random_circuit(size_t num_qubits, size_t num_gates);
+    // Deterministic: the same (seed, num_qubits, num_gates) always yields
+    // the same circuit, and a small cache keyed on that triple makes
+    // repeated calls skip regeneration entirely.
+    static BenchmarkResult benchmark_random_circuit(size_t num_qubits, size_t num_gates,
+                                                    uint64_t seed);
     static BenchmarkResult benchmark_qft_circuit(size_t num_qubits);
-    
+
+    // The GHZ workload on the sparse backend: two nonzero amplitudes
+    // throughout, so runtime tracks gate count instead of 2^n. Paired with
+    // benchmark_ghz_state it charts the sparse-vs-dense crossover.
+    static BenchmarkResult benchmark_sparse_ghz(size_t num_qubits);
+
+    // The VQE ansatz run over a batch of parameter sets in one
+    // interleaved execute_batch pass - the parameter-sweep scenario other
+    // libraries serve with batched execution.
+    static BenchmarkResult benchmark_vqe_batch(size_t num_qubits, size_t num_layers,
+                                               size_t batch_size);
+
+    // The random workload with depolarizing plus amplitude-damping noise
+    // after every gate, executed as num_trajectories Monte Carlo
+    // trajectories - the noisy-simulation scenario other stacks serve
+    // with density matrices or trajectory sampling.
+    static BenchmarkResult benchmark_noisy_random(size_t num_qubits, size_t num_gates,
+                                                  size_t num_trajectories, uint64_t seed);
+
+    // Variational workload: a hardware-efficient ansatz (per layer, ry/rz
+    // rotations on every qubit followed by a linear cnot chain), timed as
+    // one execution plus the expectation values of a transverse-field
+    // Ising Hamiltonian - the hot loop of a VQE/QAOA deployment.
+    static BenchmarkResult benchmark_vqe_ansatz(size_t num_qubits, size_t num_layers);
+
+    // Times a pre-built circuit (e.g. loaded from a QASM file); building
+    // and parsing stay off the timed path.
+    static BenchmarkResult benchmark_circuit(const QuantumCircuit& circuit,
+                                             const std::string& name);
+
+    static size_t num_threads();
+
+    // Each benchmark builds its circuit once (timed separately as
+    // construction_time_ms), runs warmup executions, then reports statistics
+    // over the timed repetitions.
+    static void set_repetitions(size_t repetitions);
+    static void set_warmup(size_t warmup);
+
+    // Selects the state-vector scalar type benchmarks execute with.
+    static void set_precision(Precision precision);
+    static Precision precision();
+
 private:
+    static TimingStats time_repetitions(const std::function<void()>& body);
+    static void execute_for_benchmark(const QuantumCircuit& circuit);
+    static const char* precision_name();
     static double get_memory_usage();
-};
\ No newline at end of file
+
+    static size_t repetitions_;
+    static size_t warmup_;
+    static Precision precision_;
+};